@@ -3,13 +3,21 @@
 #include <fmt/core.h>
 #include <samplerate.h>
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
 #include <concepts>
+#include <cstddef>
+#include <cyrus/cpu_kernels.hpp>
 #include <cyrus/sample_conversions.hpp>
 #include <filesystem>
-#include <numeric>  // midpoint
+#include <numeric>  // midpoint, gcd
+#include <optional>
 #include <sndfile.hh>
+#include <span>
+#include <thread>
 #include <tl/expected.hpp>
+#include <utility>
 #include <vector>
 
 namespace cyrus {
@@ -26,7 +34,7 @@ enum class Audio_error_code : int {
   hit_eof
 };
 
-const char* audio_error_message(const Audio_error_code errc) {
+inline const char* audio_error_message(const Audio_error_code errc) {
   const char* err_msg;
   switch (errc) {
     case Audio_error_code::unsupported_number_of_channels:
@@ -44,12 +52,123 @@ const char* audio_error_message(const Audio_error_code errc) {
   return err_msg;
 }
 
+namespace detail {
+
+// signals shorter than this many samples are resampled on the calling thread
+constexpr std::size_t min_parallel_resample_size{std::size_t{1} << 18};
+
+// Input samples of context to give either side of a run resampled by converter, so
+// that none of its filter's taps are cut off. This is the filter's half length when
+// upsampling, with some slack, and is widened by the decimation factor when
+// downsampling.
+[[nodiscard]] constexpr std::size_t resample_filter_margin(const int converter) noexcept {
+  constexpr std::size_t slack{8};
+  switch (converter) {
+    case SRC_SINC_BEST_QUALITY:
+      return 143 + slack;
+    case SRC_SINC_MEDIUM_QUALITY:
+      return 46 + slack;
+    case SRC_SINC_FASTEST:
+      return 20 + slack;
+    default:  // zero order hold and linear interpolation
+      return 1 + slack;
+  }
+}
+
+// compressed files shorter than this many frames are decoded on the calling thread
+constexpr sf_count_t min_parallel_decode_frames{sf_count_t{1} << 20};
+
+// Whether decoding a format costs far more than reading it, and a seek decodes only
+// from the independently decodable frame it lands in, so that decoding is worth
+// splitting across threads. Ogg Vorbis isn't, as libsndfile seeks within it by
+// decoding forward from the start of the stream.
+[[nodiscard]] inline bool is_compressed_format(const int format) noexcept {
+  const auto major_format = format & SF_FORMAT_TYPEMASK;
+  const auto subtype = format & SF_FORMAT_SUBMASK;
+  return major_format == SF_FORMAT_FLAC ||
+         (subtype >= SF_FORMAT_ALAC_16 && subtype <= SF_FORMAT_ALAC_32);
+}
+
+// invokes fn(i) for every i in [0, count), each on its own thread
+template <typename Fn>
+void run_in_parallel(const std::size_t count, Fn&& fn) {
+  std::vector<std::jthread> workers;
+  workers.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    workers.emplace_back([&fn, i] { fn(i); });
+  }
+}
+
+[[nodiscard]] inline std::size_t available_threads() noexcept {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+}  // namespace detail
+
 template <typename T, typename... Args>
 concept One_of = (std::same_as<T, Args> || ...);
 
 template <typename T>
 concept Libsndfile_sample = One_of<T, short, int, float, double>;
 
+struct Audio_header {
+  int sample_rate{0};
+  int channels{0};
+  sf_count_t frames{0};
+  int format{0};
+};
+
+// opens an audio file and reads only its header, without decoding any samples
+[[nodiscard]] inline tl::expected<Audio_header, Audio_error_code> read_audio_header(
+    const std::filesystem::path& audio_file) {
+  SndfileHandle sndfile_handle(audio_file.c_str());
+  if (const auto errc = static_cast<Audio_error_code>(sndfile_handle.error());
+      errc != Audio_error_code::no_error) {
+    return tl::make_unexpected(errc);
+  } else if (sndfile_handle.channels() < 1 || sndfile_handle.channels() > 2) {
+    return tl::make_unexpected(Audio_error_code::unsupported_number_of_channels);
+  }
+
+  return Audio_header{.sample_rate = sndfile_handle.samplerate(),
+                      .channels = sndfile_handle.channels(),
+                      .frames = sndfile_handle.frames(),
+                      .format = sndfile_handle.format()};
+}
+
+// frames of an audio file to decode. Up to context frames either side of them are
+// decoded too, only as filter context for resampling.
+struct Frame_range {
+  sf_count_t start{0};
+  std::optional<sf_count_t> frames{};  // through the end of the file when unset
+  sf_count_t context{0};
+
+  [[nodiscard]] bool whole() const noexcept { return start == 0 && !frames; }
+
+  // the requested frames of a file of total frames, as [first, last)
+  [[nodiscard]] std::pair<sf_count_t, sf_count_t> clip(const sf_count_t total) const {
+    const auto first = std::clamp(start, sf_count_t{0}, total);
+    return {first, frames ? std::min(total, first + *frames) : total};
+  }
+
+  // the requested frames widened by their context, as [first, last)
+  [[nodiscard]] std::pair<sf_count_t, sf_count_t> decoded(const sf_count_t total) const {
+    const auto [first, last] = clip(total);
+    return {std::max(sf_count_t{0}, first - context), std::min(total, last + context)};
+  }
+};
+
+// number of samples allocated to hold num_samples samples resampled between
+// rates. The converter may generate marginally fewer.
+[[nodiscard]] inline std::size_t resampled_size(const std::size_t num_samples,
+                                                const int from_rate, const int to_rate) {
+  if (from_rate == to_rate) {
+    return num_samples;
+  }
+  const auto resample_ratio{static_cast<double>(to_rate) / from_rate};
+  return static_cast<std::size_t>(
+      std::ceil(resample_ratio * static_cast<double>(num_samples)));
+}
+
 // represents a single channel audio file, that is loaded from a single
 // (mono) or dual (stereo) channel audio file.
 template <Sample T, typename Alloc = typename std::vector<T>::allocator_type>
@@ -59,11 +178,83 @@ class Audio_signal {
   constexpr static auto stereo_chans = 2;
   int _sample_rate{0};
   std::vector<T, Alloc> _signal{};
+  // samples either side of the signal, decoded only as filter context for resampling
+  std::size_t _context_before{0};
+  std::size_t _context_after{0};
 
   void resize_signal_sf(const sf_count_t new_size) {
     _signal.resize(static_cast<size_type>(new_size));
   }
 
+  [[nodiscard]] static Audio_error_code opened_error(const SndfileHandle& sndfile_handle) {
+    if (const auto errc = static_cast<Audio_error_code>(sndfile_handle.error());
+        errc != Audio_error_code::no_error) {
+      return errc;
+    } else if (sndfile_handle.channels() < mono_chans ||
+               sndfile_handle.channels() > stereo_chans) {
+      return Audio_error_code::unsupported_number_of_channels;
+    }
+    return Audio_error_code::no_error;
+  }
+
+  // converts any decoded stereo data to mono, then sizes the signal to frames
+  void downmix_to_mono(const int channels, const sf_count_t frames) {
+    if (channels == stereo_chans) {
+      if constexpr (std::same_as<T, float>) {
+        kernels::downmix_stereo(_signal, {_signal.data(), _signal.size() / stereo_chans});
+      } else {
+        auto read_it = _signal.cbegin();
+        auto write_it = _signal.begin();
+        while (read_it < _signal.end()) {
+          const auto left_sample = *read_it;
+          const auto right_sample = *(read_it + 1);
+          *write_it = std::midpoint(left_sample, right_sample);
+          read_it += stereo_chans;
+          write_it += mono_chans;
+        }
+      }
+    }
+    this->resize_signal_sf(frames);
+  }
+
+  void set_context(const Frame_range& range, const sf_count_t total) {
+    const auto [first, last] = range.decoded(total);
+    const auto [clip_first, clip_last] = range.clip(total);
+    _context_before = static_cast<std::size_t>(clip_first - first);
+    _context_after = static_cast<std::size_t>(last - clip_last);
+  }
+
+  // drops the samples resampled from the context around the signal
+  Audio_signal without_resampled_context(Audio_signal resampled_signal) const {
+    auto& out = resampled_signal._signal;
+    const auto ratio = static_cast<double>(resampled_signal._sample_rate) / _sample_rate;
+    const auto skipped = std::min(
+        out.size(), static_cast<std::size_t>(
+                        std::lround(ratio * static_cast<double>(_context_before))));
+    out.erase(out.begin(), out.begin() + static_cast<difference_type>(skipped));
+    out.resize(std::min(
+        out.size(), resampled_size(size(), _sample_rate, resampled_signal._sample_rate)));
+    return resampled_signal;
+  }
+
+  // resamples a contiguous run of samples with a fresh converter, returning the
+  // libsamplerate error code and the number of samples generated
+  static std::pair<int, std::size_t> resample_segment(const T* in,
+                                                      const std::size_t in_size, T* out,
+                                                      const std::size_t out_size,
+                                                      const double ratio,
+                                                      const int converter) {
+    SRC_DATA conversion_data;
+    conversion_data.data_in = in;
+    conversion_data.data_out = out;
+    conversion_data.input_frames = static_cast<long>(in_size);
+    conversion_data.output_frames = static_cast<long>(out_size);
+    conversion_data.src_ratio = ratio;
+
+    const auto src_errc = src_simple(&conversion_data, converter, 1);
+    return {src_errc, static_cast<std::size_t>(conversion_data.output_frames_gen)};
+  }
+
  public:
   using value_type = T;
   using allocator_type = Alloc;
@@ -84,24 +275,30 @@ class Audio_signal {
   Audio_signal(Audio_signal&&) noexcept = default;
   Audio_signal& operator=(Audio_signal&&) noexcept = default;
 
-  Audio_error_code load(const std::filesystem::path& audio_file) {
+  Audio_error_code load(const std::filesystem::path& audio_file,
+                        const Frame_range& range = {}) {
+    return load(SndfileHandle(audio_file.c_str()), range);
+  }
+
+  // loads from an opened handle, such as one reading through virtual I/O. Only the
+  // range's frames and context are decoded, after seeking to the first of them.
+  Audio_error_code load(SndfileHandle sndfile_handle, const Frame_range& range = {}) {
     static_assert(Libsndfile_sample<T>,
                   "To load audio, sample data must be compatible with libsndfile.");
     auto result = Audio_error_code::no_error;
 
-    // open audio file
-    SndfileHandle sndfile_handle(audio_file.c_str());
-    if (const auto errc = static_cast<Audio_error_code>(sndfile_handle.error());
-        errc != Audio_error_code::no_error) {
+    if (const auto errc = opened_error(sndfile_handle); errc != Audio_error_code::no_error) {
       return errc;
-    } else if (sndfile_handle.channels() < mono_chans ||
-               sndfile_handle.channels() > stereo_chans) {
-      return Audio_error_code::unsupported_number_of_channels;
+    }
+
+    const auto [first, last] = range.decoded(sndfile_handle.frames());
+    if (first > 0 && sndfile_handle.seek(first, SEEK_SET) != first) {
+      return Audio_error_code::hit_eof;
     }
 
     // decode and load contents
     _sample_rate = sndfile_handle.samplerate();
-    const sf_count_t num_items = sndfile_handle.channels() * sndfile_handle.frames();
+    const sf_count_t num_items = sndfile_handle.channels() * (last - first);
     this->resize_signal_sf(num_items);
     if (const auto num_read = sndfile_handle.read(_signal.data(), num_items);
         num_read < num_items) {
@@ -109,100 +306,243 @@ class Audio_signal {
       this->resize_signal_sf(num_read);
     }
 
-    // convert any stereo data to mono by averaging channels
-    if (sndfile_handle.channels() == stereo_chans) {
-      auto read_it = _signal.cbegin();
-      auto write_it = _signal.begin();
-      while (read_it < _signal.end()) {
-        const auto left_sample = *read_it;
-        const auto right_sample = *(read_it + 1);
-        *write_it = std::midpoint(left_sample, right_sample);
-        read_it += stereo_chans;
-        write_it += mono_chans;
+    downmix_to_mono(sndfile_handle.channels(), last - first);
+    set_context(range, sndfile_handle.frames());
+    return result;
+  }
+
+  // Decodes a compressed file on several threads, each decoding a contiguous run of
+  // frames through its own handle, returned by open_handle(thread index) for indices
+  // below detail::available_threads(). Each handle seeks to its run's first frame,
+  // from which the decoder resumes at the independently decodable frame containing
+  // it, so runs join seamlessly. Short or uncompressed files use a single handle.
+  template <std::invocable<std::size_t> Open_handle>
+  Audio_error_code load_parallel(Open_handle&& open_handle,
+                                 const Frame_range& range = {}) {
+    static_assert(Libsndfile_sample<T>,
+                  "To load audio, sample data must be compatible with libsndfile.");
+    SndfileHandle sndfile_handle = open_handle(std::size_t{0});
+    if (const auto errc = opened_error(sndfile_handle); errc != Audio_error_code::no_error) {
+      return errc;
+    }
+
+    const auto [first, last] = range.decoded(sndfile_handle.frames());
+    const auto frames = last - first;
+    const auto num_segments = std::min(
+        detail::available_threads(),
+        static_cast<std::size_t>(frames / detail::min_parallel_decode_frames));
+    if (!detail::is_compressed_format(sndfile_handle.format()) || num_segments <= 1) {
+      return load(std::move(sndfile_handle), range);
+    }
+
+    const auto channels = sndfile_handle.channels();
+    _sample_rate = sndfile_handle.samplerate();
+    this->resize_signal_sf(channels * frames);
+
+    const auto boundary = [&](const std::size_t seg) {
+      return first + frames * static_cast<sf_count_t>(seg) /
+                         static_cast<sf_count_t>(num_segments);
+    };
+    std::vector<Audio_error_code> segment_errcs(num_segments, Audio_error_code::no_error);
+    std::vector<sf_count_t> segment_frames(num_segments, 0);
+    detail::run_in_parallel(num_segments, [&](const std::size_t seg) {
+      auto handle = seg == 0 ? sndfile_handle : open_handle(seg);
+      if (const auto errc = opened_error(handle); errc != Audio_error_code::no_error) {
+        segment_errcs[seg] = errc;
+        return;
+      }
+
+      const auto begin = boundary(seg);
+      if (begin > 0 && handle.seek(begin, SEEK_SET) != begin) {
+        segment_errcs[seg] = Audio_error_code::hit_eof;
+        return;
+      }
+      const auto num_items = channels * (boundary(seg + 1) - begin);
+      const auto num_read =
+          handle.read(_signal.data() + channels * (begin - first), num_items);
+      segment_frames[seg] = num_read / channels;
+      if (num_read < num_items) {
+        segment_errcs[seg] = Audio_error_code::hit_eof;
+      }
+    });
+
+    // as in a single pass, decoding ends where the first run came up short
+    auto result = Audio_error_code::no_error;
+    sf_count_t decoded_frames{0};
+    for (std::size_t seg = 0; seg < num_segments; ++seg) {
+      if (segment_errcs[seg] != Audio_error_code::no_error &&
+          segment_errcs[seg] != Audio_error_code::hit_eof) {
+        return segment_errcs[seg];
+      }
+      decoded_frames += segment_frames[seg];
+      if (segment_errcs[seg] == Audio_error_code::hit_eof) {
+        result = Audio_error_code::hit_eof;
+        break;
       }
     }
-    this->resize_signal_sf(sndfile_handle.frames());
+    this->resize_signal_sf(channels * decoded_frames);
 
+    downmix_to_mono(channels, frames);
+    set_context(range, sndfile_handle.frames());
     return result;
   }
 
 
-  template <Sample U>
-  Audio_signal<U> remapped(
-      const typename Sample_remapper<U, T>::Remap_values& remap_vals = {}) const {
-    const Sample_remapper<U, T> remapper(remap_vals);
-    Audio_signal<U> remapped;
-    remapped.resize(_signal.size());
-
-    for (size_type i = 0; i < _signal.size(); ++i) {
-      remapped[i] = remapper(_signal[i]);
-    }
-    return remapped;
+  // out must hold encoded_size(size(), sizeof(U), format.bits) bytes
+  template <std::unsigned_integral U>
+  void encode(const typename Sample_remapper<U, T>::Remap_values& remap_vals,
+              const Word_format& format, const std::span<std::byte> out) const {
+    encode_samples<U, T>({_signal.data() + _context_before, size()},
+                         Sample_remapper<U, T>(remap_vals), format, out);
   }
 
 
-  tl::expected<Audio_signal, Audio_error_code> resampled(const int sample_rate) const {
+  // Long signals are split into segments that are resampled concurrently and
+  // stitched back in order. Segment boundaries are placed where input and output
+  // sample instants coincide, and every segment is resampled with enough
+  // surrounding input to cover the converter's filter, so no tap is truncated at a
+  // seam. The result matches a single-threaded pass to within float rounding of the
+  // converter's phase accumulation (below 1e-5 of full scale).
+  tl::expected<Audio_signal, Audio_error_code> resampled(
+      const int sample_rate, const int converter = SRC_SINC_BEST_QUALITY) const {
     static_assert(std::same_as<T, float>,
                   "To resample audio signals, both the input "
                   "and output samples must be stored as floats.");
 
     if (_sample_rate == sample_rate) {
-      return *this;
+      Audio_signal clip;
+      clip._sample_rate = _sample_rate;
+      clip._signal.assign(begin(), end());
+      return clip;
     }
 
     Audio_signal resampled_signal;
     resampled_signal._sample_rate = sample_rate;
     const auto resample_ratio{static_cast<double>(sample_rate) / _sample_rate};
-    const auto resampled_size{static_cast<sf_count_t>(
-        std::ceil(resample_ratio * static_cast<double>(_signal.size())))};
-    resampled_signal.resize_signal_sf(resampled_size);
+    resampled_signal.resize(resampled_size(_signal.size(), _sample_rate, sample_rate));
+
+    // input and output samples coincide every in_period and out_period samples
+    const auto rate_gcd = std::gcd(_sample_rate, sample_rate);
+    const auto in_period = static_cast<size_type>(_sample_rate / rate_gcd);
+    const auto out_period = static_cast<size_type>(sample_rate / rate_gcd);
+    const auto min_segment_size = std::max(detail::min_parallel_resample_size, in_period);
+    const auto num_segments =
+        std::min(detail::available_threads(), _signal.size() / min_segment_size);
+
+    if (num_segments <= 1) {
+      auto& out = resampled_signal._signal;
+      const auto [src_errc, generated] = resample_segment(
+          _signal.data(), _signal.size(), out.data(), out.size(), resample_ratio,
+          converter);
+      if (const auto errc = static_cast<Audio_error_code>(src_errc);
+          errc != Audio_error_code::no_error) {
+        return tl::make_unexpected(errc);
+      }
+      resampled_signal.resize_signal_sf(static_cast<sf_count_t>(generated));
+      return without_resampled_context(std::move(resampled_signal));
+    }
 
-    SRC_DATA conversion_data;
-    conversion_data.data_in = _signal.data();
-    conversion_data.data_out = resampled_signal._signal.data();
-    conversion_data.input_frames = static_cast<long>(_signal.size());
-    conversion_data.output_frames = resampled_size;
-    conversion_data.src_ratio = resample_ratio;
-
-    const auto src_errc = src_simple(&conversion_data, SRC_SINC_BEST_QUALITY, 1);
-    if (const auto errc = static_cast<Audio_error_code>(src_errc);
-        errc != Audio_error_code::no_error) {
-      return tl::make_unexpected(errc);
+    // segment boundaries and margins, in input samples, aligned to in_period
+    const auto decimation =
+        std::max(1.0, static_cast<double>(_sample_rate) / sample_rate);
+    const auto margin_periods = static_cast<size_type>(std::ceil(
+        static_cast<double>(detail::resample_filter_margin(converter)) * decimation /
+        static_cast<double>(in_period)));
+    const auto margin = margin_periods * in_period;
+    const auto boundary = [&](const size_type seg) {
+      if (seg == num_segments) {
+        return _signal.size();
+      }
+      return _signal.size() * seg / num_segments / in_period * in_period;
+    };
+    const auto to_out = [&](const size_type in_idx) {
+      return in_idx / in_period * out_period;
+    };
+
+    std::vector<int> segment_errcs(num_segments, 0);
+    std::vector<size_type> segment_sizes(num_segments, 0);
+    detail::run_in_parallel(num_segments, [&](const size_type seg) {
+      const auto begin = boundary(seg);
+      const auto end = boundary(seg + 1);
+      const auto padded_begin = begin < margin ? 0 : begin - margin;
+      const auto padded_end = std::min(_signal.size(), end + margin);
+      const auto padded_size = padded_end - padded_begin;
+
+      std::vector<T> scratch(static_cast<size_type>(
+          std::ceil(resample_ratio * static_cast<double>(padded_size))));
+      const auto [src_errc, generated] =
+          resample_segment(_signal.data() + padded_begin, padded_size, scratch.data(),
+                           scratch.size(), resample_ratio, converter);
+      segment_errcs[seg] = src_errc;
+
+      // keep only the samples that lie within this segment's output range
+      const auto out_begin = to_out(begin);
+      const auto out_end =
+          seg + 1 == num_segments ? resampled_signal._signal.size() : to_out(end);
+      const auto skipped = out_begin - to_out(padded_begin);
+      const auto kept = std::min(out_end - out_begin,
+                                 generated > skipped ? generated - skipped : 0);
+      std::copy_n(scratch.cbegin() + static_cast<difference_type>(skipped), kept,
+                  resampled_signal._signal.begin() +
+                      static_cast<difference_type>(out_begin));
+      segment_sizes[seg] = kept;
+    });
+
+    for (const auto src_errc : segment_errcs) {
+      if (const auto errc = static_cast<Audio_error_code>(src_errc);
+          errc != Audio_error_code::no_error) {
+        return tl::make_unexpected(errc);
+      }
     }
 
-    resampled_signal.resize_signal_sf(conversion_data.output_frames_gen);
-    return resampled_signal;
+    // only the final segment may come up short of its expected output
+    const auto last = num_segments - 1;
+    resampled_signal.resize_signal_sf(
+        static_cast<sf_count_t>(to_out(boundary(last)) + segment_sizes[last]));
+    return without_resampled_context(std::move(resampled_signal));
   }
 
   void resize(const size_type size) { _signal.resize(size); }
 
   [[nodiscard]] int sample_rate() const noexcept { return _sample_rate; }
 
+  // samples are accessed without the context decoded around them
+
   [[nodiscard]] value_type& operator[](const size_type idx) noexcept {
-    return _signal[idx];
+    return _signal[_context_before + idx];
   }
 
   [[nodiscard]] const value_type& operator[](const size_type idx) const noexcept {
-    return _signal[idx];
+    return _signal[_context_before + idx];
   }
 
-  [[nodiscard]] iterator begin() noexcept { return _signal.begin(); }
+  [[nodiscard]] iterator begin() noexcept {
+    return _signal.begin() + static_cast<difference_type>(_context_before);
+  }
 
-  [[nodiscard]] iterator end() noexcept { return _signal.end(); }
+  [[nodiscard]] iterator end() noexcept {
+    return _signal.end() - static_cast<difference_type>(_context_after);
+  }
 
-  [[nodiscard]] const_iterator begin() const noexcept { return _signal.begin(); }
+  [[nodiscard]] const_iterator begin() const noexcept {
+    return _signal.begin() + static_cast<difference_type>(_context_before);
+  }
 
-  [[nodiscard]] const_iterator end() const noexcept { return _signal.end(); }
+  [[nodiscard]] const_iterator end() const noexcept {
+    return _signal.end() - static_cast<difference_type>(_context_after);
+  }
 
-  [[nodiscard]] const_iterator cbegin() const noexcept { return _signal.cbegin(); }
+  [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
 
-  [[nodiscard]] const_iterator cend() const noexcept { return _signal.cend(); }
+  [[nodiscard]] const_iterator cend() const noexcept { return end(); }
 
   // number of samples
-  [[nodiscard]] size_type size() const noexcept { return _signal.size(); }
+  [[nodiscard]] size_type size() const noexcept {
+    return _signal.size() - _context_before - _context_after;
+  }
 
   [[nodiscard]] const char* data() const noexcept {
-    return std::bit_cast<const char*>(_signal.data());
+    return std::bit_cast<const char*>(_signal.data() + _context_before);
   }
 };
 
@@ -0,0 +1,150 @@
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <array>
+#include <cyrus/bundle.hpp>
+#include <cyrus/checksum.hpp>
+#include <cyrus/output_file.hpp>
+#include <cyrus/try.hpp>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace cyrus {
+
+namespace {
+
+constexpr std::array<char, 4> bundle_magic{'C', 'Y', 'R', 'B'};
+constexpr std::array<std::byte, bundle_sector_size> zero_sector{};
+
+[[nodiscard]] constexpr std::uint64_t sector_aligned(const std::uint64_t size) noexcept {
+  return (size + bundle_sector_size - 1) / bundle_sector_size * bundle_sector_size;
+}
+
+template <std::unsigned_integral T>
+void put_le(std::byte*& dst, const T value) noexcept {
+  for (std::size_t b = 0; b < sizeof(T); ++b) {
+    *dst++ = static_cast<std::byte>(value >> (8 * b));
+  }
+}
+
+template <std::unsigned_integral T>
+[[nodiscard]] T get_le(const std::byte*& src) noexcept {
+  T value{0};
+  for (std::size_t b = 0; b < sizeof(T); ++b) {
+    value |= static_cast<T>(std::to_integer<T>(*src++) << (8 * b));
+  }
+  return value;
+}
+
+[[nodiscard]] std::vector<std::byte> serialize_index(
+    const std::span<const Bundle_clip> clips) {
+  const auto data_offset = clips.empty() ? sector_aligned(bundle_header_size)
+                                         : clips.front().offset;
+  std::vector<std::byte> index(data_offset);
+  auto* dst = index.data();
+
+  std::copy_n(std::bit_cast<const std::byte*>(bundle_magic.data()), bundle_magic.size(),
+              dst);
+  dst += bundle_magic.size();
+  put_le(dst, bundle_version);
+  put_le(dst, static_cast<std::uint16_t>(bundle_entry_size));
+  put_le(dst, static_cast<std::uint32_t>(clips.size()));
+  put_le(dst, static_cast<std::uint32_t>(data_offset));
+
+  for (const auto& clip : clips) {
+    const auto name_size = std::min(clip.name.size(), bundle_name_size - 1);
+    std::copy_n(std::bit_cast<const std::byte*>(clip.name.data()), name_size, dst);
+    dst += bundle_name_size;
+    put_le(dst, clip.offset);
+    put_le(dst, clip.length);
+    put_le(dst, clip.sample_rate);
+    put_le(dst, clip.word_size);
+    put_le(dst, clip.bits);
+    put_le(dst, static_cast<std::uint8_t>(clip.byte_order == std::endian::big));
+    put_le(dst, std::uint8_t{0});
+  }
+  return index;
+}
+
+}  // namespace
+
+std::uint64_t layout_bundle(const std::span<Bundle_clip> clips) {
+  auto offset = sector_aligned(bundle_header_size + clips.size() * bundle_entry_size);
+  for (auto& clip : clips) {
+    clip.offset = offset;
+    offset += sector_aligned(clip.length);
+  }
+  return offset;
+}
+
+tl::expected<std::uint32_t, std::string> write_bundle(
+    const fs::path& path, const std::span<const Bundle_clip> clips,
+    const std::span<const std::span<const std::byte>> clip_words,
+    const Write_layout& layout) {
+  const auto index = serialize_index(clips);
+
+  // each clip is followed by the zeros that pad it to the next sector
+  std::vector<std::span<const std::byte>> pieces{index};
+  for (const auto words : clip_words) {
+    pieces.push_back(words);
+    const auto padding = sector_aligned(words.size()) - words.size();
+    pieces.emplace_back(zero_sector.data(), padding);
+  }
+
+  std::uint32_t checksum{0};
+  for (const auto piece : pieces) {
+    checksum = crc32c(piece, checksum);
+  }
+  REQ(write_file_atomically(path, pieces, layout))
+  return checksum;
+}
+
+tl::expected<std::vector<Bundle_clip>, std::string> read_bundle_index(
+    const fs::path& path) {
+  std::ifstream bundle(path, std::ios_base::in | std::ios_base::binary);
+  const auto read_bytes = [&](std::vector<std::byte>& bytes) {
+    bundle.read(std::bit_cast<char*>(bytes.data()),
+                static_cast<std::streamsize>(bytes.size()));
+    return bundle.good();
+  };
+
+  std::vector<std::byte> header(bundle_header_size);
+  if (!read_bytes(header) ||
+      !std::equal(bundle_magic.begin(), bundle_magic.end(),
+                  std::bit_cast<const char*>(header.data()))) {
+    return tl::make_unexpected(fmt::format("{} is not a cyrus bundle.", path));
+  }
+
+  const auto* src = header.data() + bundle_magic.size();
+  const auto version = get_le<std::uint16_t>(src);
+  const auto entry_size = get_le<std::uint16_t>(src);
+  const auto num_clips = get_le<std::uint32_t>(src);
+  if (version != bundle_version || entry_size < bundle_entry_size) {
+    return tl::make_unexpected(fmt::format(
+        "The bundle {} has an unsupported version {} or entry size {}.", path, version,
+        entry_size));
+  }
+
+  std::vector<Bundle_clip> clips(num_clips);
+  std::vector<std::byte> entry(entry_size);
+  for (auto& clip : clips) {
+    if (!read_bytes(entry)) {
+      return tl::make_unexpected(fmt::format("The bundle {} has a truncated index.", path));
+    }
+    const auto* const name = std::bit_cast<const char*>(entry.data());
+    clip.name.assign(name, std::find(name, name + bundle_name_size, '\0'));
+    src = entry.data() + bundle_name_size;
+    clip.offset = get_le<std::uint64_t>(src);
+    clip.length = get_le<std::uint64_t>(src);
+    clip.sample_rate = get_le<std::uint32_t>(src);
+    clip.word_size = get_le<std::uint8_t>(src);
+    clip.bits = get_le<std::uint8_t>(src);
+    clip.byte_order = get_le<std::uint8_t>(src) ? std::endian::big : std::endian::little;
+  }
+  return clips;
+}
+
+}  // namespace cyrus
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cyrus/output_file.hpp>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tl/expected.hpp>
+#include <vector>
+
+namespace cyrus {
+
+// A bundle holds every clip of a run in one contiguous file, so miley opens a
+// single file and seeks straight to any clip. All fields are little-endian.
+//
+//   header (16 bytes)
+//     magic        char[4]   "CYRB"
+//     version      uint16
+//     entry_size   uint16    size of each index entry, 64
+//     num_clips    uint32
+//     data_offset  uint32    offset of the first clip
+//   index (num_clips entries of entry_size bytes)
+//     name         char[40]  clip name, NUL padded
+//     offset       uint64    offset of the clip's words, sector aligned
+//     length       uint64    length of the clip's words, in bytes
+//     sample_rate  uint32
+//     word_size    uint8     bytes per word, or 0 when bit-packed
+//     bits         uint8     bits per packed sample, or 0 for whole words
+//     byte_order   uint8     0 for little-endian, 1 for big-endian
+//     reserved     uint8
+//   clips, each starting on a sector boundary and zero padded to the next
+
+constexpr const std::string_view bundle_file_name{"bundle.bin"};
+constexpr const std::uint16_t bundle_version{1};
+constexpr const std::size_t bundle_sector_size{512};
+constexpr const std::size_t bundle_header_size{16};
+constexpr const std::size_t bundle_entry_size{64};
+constexpr const std::size_t bundle_name_size{40};
+
+struct Bundle_clip {
+  std::string name{};  // truncated to bundle_name_size - 1 characters when written
+  std::uint64_t offset{0};
+  std::uint64_t length{0};
+  std::uint32_t sample_rate{0};
+  std::uint8_t word_size{0};
+  std::uint8_t bits{0};
+  std::endian byte_order{std::endian::little};
+};
+
+// assigns each clip its sector aligned offset, returning the bundle's total size
+std::uint64_t layout_bundle(std::span<Bundle_clip> clips);
+
+// Writes a bundle of laid out clips, each followed by the words of its clip, in
+// a single sequential pass. Returns the CRC32C of the whole bundle.
+[[nodiscard]] tl::expected<std::uint32_t, std::string> write_bundle(
+    const std::filesystem::path&, std::span<const Bundle_clip> clips,
+    std::span<const std::span<const std::byte>> clip_words,
+    const Write_layout& layout = {});
+
+// reference reader of a bundle's header and index, as miley reads them
+[[nodiscard]] tl::expected<std::vector<Bundle_clip>, std::string> read_bundle_index(
+    const std::filesystem::path&);
+
+}  // namespace cyrus
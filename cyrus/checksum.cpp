@@ -0,0 +1,122 @@
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <cyrus/checksum.hpp>
+#include <filesystem>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace cyrus {
+
+namespace {
+
+constexpr std::uint32_t crc32c_polynomial{0x82F63B78};  // reversed Castagnoli
+constexpr std::size_t read_back_chunk_size{std::size_t{1} << 20};
+
+constexpr std::array<std::uint32_t, 256> crc32c_table = [] {
+  std::array<std::uint32_t, 256> table{};
+  for (std::uint32_t i = 0; i < table.size(); ++i) {
+    auto crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1u) ? crc32c_polynomial : 0u);
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+std::uint32_t crc32c_software(std::uint32_t crc, const std::span<const std::byte> data) {
+  for (const auto byte : data) {
+    crc = crc32c_table[(crc ^ std::to_integer<std::uint32_t>(byte)) & 0xFFu] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) std::uint32_t crc32c_sse42(
+    const std::uint32_t crc, const std::span<const std::byte> data) {
+  std::uint64_t crc64{crc};
+  std::size_t i = 0;
+  for (; i + sizeof(std::uint64_t) <= data.size(); i += sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, data.data() + i, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  auto crc32 = static_cast<std::uint32_t>(crc64);
+  for (; i < data.size(); ++i) {
+    crc32 = _mm_crc32_u8(crc32, std::to_integer<std::uint8_t>(data[i]));
+  }
+  return crc32;
+}
+
+[[nodiscard]] bool has_sse42() noexcept {
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+}
+#endif
+
+}  // namespace
+
+std::uint32_t crc32c(const std::span<const std::byte> data,
+                     const std::uint32_t crc) noexcept {
+#if defined(__x86_64__)
+  if (has_sse42()) {
+    return ~crc32c_sse42(~crc, data);
+  }
+#endif
+  return ~crc32c_software(~crc, data);
+}
+
+std::string_view crc32c_implementation() noexcept {
+#if defined(__x86_64__)
+  if (has_sse42()) {
+    return "sse4.2";
+  }
+#endif
+  return "table";
+}
+
+tl::expected<std::uint32_t, std::string> read_back_crc32c(const fs::path& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return tl::make_unexpected(fmt::format("Couldn't open {} to verify it: {}", path,
+                                           std::strerror(errno)));
+  }
+
+  // persist the file, then drop its now clean pages so they're read from the device
+  const int flush_err = ::fdatasync(fd) != 0
+                            ? errno
+                            : ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  if (flush_err != 0) {
+    ::close(fd);
+    return tl::make_unexpected(fmt::format("Couldn't flush {} to verify it: {}", path,
+                                           std::strerror(flush_err)));
+  }
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  std::vector<std::byte> chunk(read_back_chunk_size);
+  std::uint32_t crc{0};
+  ssize_t num_read;
+  while ((num_read = ::read(fd, chunk.data(), chunk.size())) > 0) {
+    crc = crc32c({chunk.data(), static_cast<std::size_t>(num_read)}, crc);
+  }
+  const auto err = errno;
+  ::close(fd);
+  if (num_read < 0) {
+    return tl::make_unexpected(
+        fmt::format("Couldn't read back {}: {}", path, std::strerror(err)));
+  }
+  return crc;
+}
+
+}  // namespace cyrus
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tl/expected.hpp>
+
+namespace cyrus {
+
+// CRC32C (Castagnoli) of data, continuing from a previously returned crc. Uses the
+// SSE4.2 crc32 instruction when the running CPU supports it.
+[[nodiscard]] std::uint32_t crc32c(std::span<const std::byte> data,
+                                   std::uint32_t crc = 0) noexcept;
+
+// names the implementation crc32c() uses on the running CPU
+[[nodiscard]] std::string_view crc32c_implementation() noexcept;
+
+// CRC32C of a file's contents as stored on its device, rather than as cached.
+// The file's dirty pages are flushed and evicted from the page cache before it
+// is read back.
+[[nodiscard]] tl::expected<std::uint32_t, std::string> read_back_crc32c(
+    const std::filesystem::path&);
+
+}  // namespace cyrus
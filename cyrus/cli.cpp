@@ -1,13 +1,21 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <charconv>
+#include <cmath>
 #include <concepts>
+#include <cyrus/bundle.hpp>
 #include <cyrus/cli.hpp>
+#include <cyrus/device_events.hpp>
 #include <cyrus/try.hpp>
+#include <filesystem>
 #include <iostream>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <tl/expected.hpp>
 #include <utility>
 
@@ -24,25 +32,80 @@ constexpr Flags_t range_flags{"-r", "--out_range"};
 constexpr Flags_t word_size_flags{"-w", "--word_size"};
 constexpr Flags_t sample_rate_flags{"-s", "--sample_rate"};
 constexpr Flags_t enlarge_flags{"-e", "--enlarge"};
+constexpr Flags_t endian_flags{"-b", "--endian"};
+constexpr Flags_t bits_flags{"-p", "--bits"};
+constexpr int max_packed_bits{32};
+constexpr Flags_t verify_flags{"-v", "--verify"};
+constexpr Flags_t resume_flags{"-c", "--resume"};
+constexpr Flags_t mmap_flags{"-m", "--mmap"};
+constexpr Flags_t bundle_flags{"-u", "--bundle"};
+constexpr Flags_t quality_flags{"-q", "--quality"};
+constexpr Flags_t kernels_flags{"-k", "--kernels"};
+constexpr Flags_t stats_flags{"-t", "--stats"};
+constexpr Flags_t write_unit_flags{"-a", "--write_unit"};
+constexpr int write_unit_granularity{512};
+constexpr Flags_t profile_flags{"-o", "--profile"};
+constexpr char profile_option_delimiter{':'};
+constexpr Flags_t start_flags{"-f", "--start"};
+constexpr Flags_t duration_flags{"-l", "--duration"};
+constexpr char file_time_range_delimiter{'@'};
+constexpr Flags_t watch_flags{"-x", "--watch"};
+
+template <typename T, std::size_t N>
+using Choices = std::array<std::pair<std::string_view, T>, N>;
+constexpr Choices<std::endian, 2> endian_choices{
+    {{"little", std::endian::little}, {"big", std::endian::big}}};
+constexpr Choices<Resample_quality, 4> quality_choices{
+    {{"fastest", Resample_quality::fastest},
+     {"medium", Resample_quality::medium},
+     {"best", Resample_quality::best},
+     {"auto", Resample_quality::automatic}}};
+constexpr Choices<Kernel_variant, 3> kernels_choices{{{"sse2", Kernel_variant::baseline},
+                                                      {"avx2", Kernel_variant::avx2},
+                                                      {"avx512", Kernel_variant::avx512}}};
 
 // clang-format off
 constexpr const char* const help_message_fmt =
     "Usage: cyrus [options] <block_device> <audio_files...>\n"
+    "       cyrus [options] {watch_long} <netlink|events_file> <audio_files...>\n"
     " Write the provided audio files to a FAT32 block device in unsigned RAW format\n"
     "\n"
     "Ex. 1: cyrus /dev/nvme0n1 ordinary_girl.aiff nobodys_perfect.wav who_said.wav\n"
     "Ex. 2: cyrus -r 205,3890 -w 2 /dev/nvme0n1 he_coule_be_the_one.aif\n"
+    "Ex. 3: ffmpeg -i this_is_me.mp3 -f wav - | cyrus - - > this_is_me.raw\n"
+    "Ex. 4: cyrus -f 95.5 -l 3 /dev/sda1 still_the_same.flac moving_on.flac@12,4.5\n"
+    "Ex. 5: cyrus -o rev_a -o rev_b:word_size=1:out_range=0,255:sample_rate=20000 /dev/sda1 who_said.wav\n"
+    "Ex. 6: cyrus -x netlink -v ordinary_girl.aiff who_said.wav\n"
     "\n"
     "Positional Arguments:\n"
-    "block_device\tDestination block device\n"
-    "audio_files\tInput wav and aiff formatted audio files\n"
+    "block_device\tDestination block device, or {stdio} to stream words to stdout\n"
+    "audio_files\tInput wav, aiff, flac or ogg formatted audio files, or {stdio} to read stdin.\n"
+    "\t\tFLAC and ALAC files are decoded on every core. Suffix a file with\n"
+    "\t\t{at}<start>[,<duration>] to convert only that section of it\n"
     "\n"
     "Optional Arguments:\n"
     "{help} {help_long}     \t\tShow this help message and exit\n"
     "{word} {word_long} <int> \tNumber of bytes per written word [Default {word_default}]\n"
     "{range} {range_long} <min,max> Range to generate output samples [Default {range_min_default},{range_max_default}]\n"
     "{rate} {rate_long} <int>\tSamples/second of written audio [Default {rate_default}]\n"
-    "{enlarge} {enlarge_long} \t\tEnlarge the input waveform to occupy the entire output range\n";
+    "{enlarge} {enlarge_long} \t\tEnlarge the input waveform to occupy the entire output range\n"
+    "{endian} {endian_long} <little|big>\tByte order of written words [Default {endian_default}]\n"
+    "{bits} {bits_long} <int>\t\tPack samples densely at 1-{bits_max} bits each, instead of whole words\n"
+    "{verify} {verify_long} \t\tRead back every written file and compare its checksum\n"
+    "{resume} {resume_long} \t\tContinue an interrupted run, skipping the files it completed\n"
+    "{mmap} {mmap_long} \t\tEncode words straight into memory-mapped destination files\n"
+    "{bundle} {bundle_long} \t\tWrite every clip into a single indexed {bundle_file}\n"
+    "{quality} {quality_long} <fastest|medium|best|auto> Resampler quality, auto picks the fastest finer than the output range [Default auto]\n"
+    "{kernels} {kernels_long} <sse2|avx2|avx512> Force a variant of the vectorized sample kernels [Default best supported]\n"
+    "{stats} {stats_long} \t\tShow the kernel variant and instruction sets in use\n"
+    "{write_unit} {write_unit_long} <int>\tBytes per aligned write to the device, a multiple of {write_unit_granularity} [Default from the device's queue geometry]\n"
+    "{profile} {profile_long} <dir[:option=value...]> Write into dir of the device, overriding the word_size, out_range,\n"
+    "\t\tsample_rate or enlarge=<0|1> options. Repeat to write several profiles from one decode\n"
+    "{start} {start_long} <seconds>\tConvert audio files from this time, decoding only what's needed [Default 0]\n"
+    "{duration} {duration_long} <seconds>\tConvert this long a section of audio files [Default through the end]\n"
+    "{watch} {watch_long} <netlink|events_file> Convert once, then write every FAT32 card that's inserted,\n"
+    "\t\tas announced by the kernel's {netlink} uevents or by uevent lines read from a file,\n"
+    "\t\tin place of the block_device argument\n";
 // clang-format on
 
 
@@ -83,6 +146,59 @@ template <std::integral T>
   }
 }
 
+template <typename T, std::size_t N>
+[[nodiscard]] tl::expected<T, std::string> next_arg_to_choice(
+    const Program_arguments prog_args, const std::string_view option_name,
+    const Choices<T, N>& choices) {
+  const auto choice_names = [&] {
+    std::string names;
+    for (const auto& [name, value] : choices) {
+      names += names.empty() ? "" : "|";
+      names += name;
+    }
+    return names;
+  };
+
+  if (prog_args.size() < 2) {
+    return tl::make_unexpected(fmt::format(
+        "Expected one of {} following the provided {} flag, {}.", choice_names(),
+        option_name, prog_args.front()));
+  }
+
+  const auto choice_arg = *(prog_args.begin() + 1);
+  if (const auto it = std::ranges::find(choices, choice_arg, [](const auto& c) {
+        return c.first;
+      });
+      it != choices.end()) {
+    return it->second;
+  }
+  return tl::make_unexpected(
+      fmt::format("Invalid argument '{}' for option {}: expected {}", choice_arg,
+                  option_name, choice_names()));
+}
+
+[[nodiscard]] tl::expected<double, std::string> next_arg_to_seconds(
+    const Program_arguments prog_args, const std::string_view option_name) {
+  if (prog_args.size() < 2) {
+    return tl::make_unexpected(
+        fmt::format("Expected a number of seconds following the provided {} flag, {}.",
+                    option_name, prog_args.front()));
+  }
+
+  const auto seconds_arg = *(prog_args.begin() + 1);
+  const auto* const seconds_end = seconds_arg.data() + seconds_arg.size();
+  double seconds;
+  if (const auto result = std::from_chars(seconds_arg.data(), seconds_end, seconds);
+      result.ec != std::errc{} || result.ptr != seconds_end || !std::isfinite(seconds) ||
+      seconds < 0.0) {
+    return tl::make_unexpected(
+        fmt::format("Failed parsing argument '{}' to a non-negative number of seconds "
+                    "for option {}",
+                    seconds_arg, option_name));
+  }
+  return seconds;
+}
+
 using Range_type = std::remove_cvref_t<decltype(Parsed_arguments::range_min)>;
 static_assert(std::is_same_v<Range_type,
                              std::remove_cvref_t<decltype(Parsed_arguments::range_max)>>,
@@ -128,6 +244,55 @@ next_arg_to_range(const Program_arguments prog_args, const std::string_view opti
 }
 
 
+// profiles are formatted as <directory>[:<option>=<value>...], where options are
+// named by the long flags they override
+[[nodiscard]] tl::expected<Output_profile, std::string> next_arg_to_profile(
+    const Program_arguments prog_args) {
+  if (prog_args.size() < 2) {
+    return tl::make_unexpected(
+        fmt::format("Expected a directory and its options following the provided {} "
+                    "flag, {}.",
+                    "profile", prog_args.front()));
+  }
+
+  std::string_view profile_arg = *(prog_args.begin() + 1);
+  const auto next_field = [&] {
+    const auto field = profile_arg.substr(0, profile_arg.find(profile_option_delimiter));
+    profile_arg.remove_prefix(std::min(field.size() + 1, profile_arg.size()));
+    return field;
+  };
+
+  Output_profile profile{.directory = next_field()};
+  while (!profile_arg.empty()) {
+    const auto option = next_field();
+    const auto equals_idx = option.find('=');
+    const auto name = option.substr(0, equals_idx);
+    const std::array<std::string_view, 2> value_args{
+        prog_args.front(),
+        equals_idx == std::string_view::npos ? std::string_view{}
+                                             : option.substr(equals_idx + 1)};
+    if (name == "word_size") {
+      profile.word_size = TRY(next_arg_to_int(value_args, "profile word_size"));
+    } else if (name == "out_range") {
+      profile.range = TRY(next_arg_to_range(value_args, "profile out_range"));
+    } else if (name == "sample_rate") {
+      profile.sample_rate = TRY(next_arg_to_int(value_args, "profile sample_rate"));
+    } else if (name == "enlarge" && (equals_idx == std::string_view::npos ||
+                                     value_args.back() == "1")) {
+      profile.enlarge = true;
+    } else if (name == "enlarge" && value_args.back() == "0") {
+      profile.enlarge = false;
+    } else {
+      return tl::make_unexpected(fmt::format(
+          "Unrecognized option '{}' in the profile {}. Expected word_size=<int>, "
+          "out_range=<min,max>, sample_rate=<int> or enlarge[=<0|1>].",
+          option, *(prog_args.begin() + 1)));
+    }
+  }
+  return profile;
+}
+
+
 struct Parse_context {
   Program_arguments prog_args{};
   Parsed_arguments parsed_args{};
@@ -145,7 +310,8 @@ struct Parse_context {
   auto& parsed_opts = ctx.parsed_args;
   auto prog_arg_it = ctx.prog_args.begin();
   const auto last = ctx.prog_args.end();
-  for (; prog_arg_it < ctx.prog_args.end() && prog_arg_it->front() == '-';
+  for (; prog_arg_it < ctx.prog_args.end() && prog_arg_it->front() == '-' &&
+         *prog_arg_it != stdio_path;
        ++prog_arg_it) {
     if (is_flag(help_flags, *prog_arg_it)) {
       parsed_opts.help = true;
@@ -158,6 +324,51 @@ struct Parse_context {
       ++prog_arg_it;
     } else if (is_flag(enlarge_flags, *prog_arg_it)) {
       parsed_opts.enlarge = true;
+    } else if (is_flag(endian_flags, *prog_arg_it)) {
+      parsed_opts.endian =
+          TRY(next_arg_to_choice({prog_arg_it, last}, "endian", endian_choices));
+      ++prog_arg_it;
+    } else if (is_flag(bits_flags, *prog_arg_it)) {
+      parsed_opts.bits = TRY(next_arg_to_int({prog_arg_it, last}, "bits"));
+      ++prog_arg_it;
+    } else if (is_flag(verify_flags, *prog_arg_it)) {
+      parsed_opts.verify = true;
+    } else if (is_flag(resume_flags, *prog_arg_it)) {
+      parsed_opts.resume = true;
+    } else if (is_flag(mmap_flags, *prog_arg_it)) {
+      parsed_opts.mmap = true;
+    } else if (is_flag(bundle_flags, *prog_arg_it)) {
+      parsed_opts.bundle = true;
+    } else if (is_flag(quality_flags, *prog_arg_it)) {
+      parsed_opts.quality =
+          TRY(next_arg_to_choice({prog_arg_it, last}, "quality", quality_choices));
+      ++prog_arg_it;
+    } else if (is_flag(kernels_flags, *prog_arg_it)) {
+      parsed_opts.kernels =
+          TRY(next_arg_to_choice({prog_arg_it, last}, "kernels", kernels_choices));
+      ++prog_arg_it;
+    } else if (is_flag(stats_flags, *prog_arg_it)) {
+      parsed_opts.stats = true;
+    } else if (is_flag(write_unit_flags, *prog_arg_it)) {
+      parsed_opts.write_unit = TRY(next_arg_to_int({prog_arg_it, last}, "write_unit"));
+      ++prog_arg_it;
+    } else if (is_flag(profile_flags, *prog_arg_it)) {
+      parsed_opts.profiles.push_back(TRY(next_arg_to_profile({prog_arg_it, last})));
+      ++prog_arg_it;
+    } else if (is_flag(start_flags, *prog_arg_it)) {
+      parsed_opts.time_range.start = TRY(next_arg_to_seconds({prog_arg_it, last}, "start"));
+      ++prog_arg_it;
+    } else if (is_flag(duration_flags, *prog_arg_it)) {
+      parsed_opts.time_range.duration =
+          TRY(next_arg_to_seconds({prog_arg_it, last}, "duration"));
+      ++prog_arg_it;
+    } else if (is_flag(watch_flags, *prog_arg_it)) {
+      if (prog_arg_it + 1 == last) {
+        return tl::make_unexpected(
+            fmt::format("Expected an event source following the provided {} flag, {}.",
+                        "watch", *prog_arg_it));
+      }
+      parsed_opts.watch = std::string(*++prog_arg_it);
     } else if (is_flag(range_flags, *prog_arg_it)) {
       const auto [min, max] = TRY(next_arg_to_range({prog_arg_it, last}, "output_range"));
       parsed_opts.range_min = min;
@@ -176,6 +387,52 @@ struct Parse_context {
     const Parse_context& ctx) {
   const auto& parsed = ctx.parsed_args;
 
+  // Shared options only provide the defaults of profiles, so each profile is checked
+  // as it applies them, and must be written into a directory of its own
+  for (auto profile_it = parsed.profiles.begin(); profile_it != parsed.profiles.end();
+       ++profile_it) {
+    const auto& directory = profile_it->directory;
+    if (directory.empty() || directory.is_absolute() ||
+        std::ranges::find(directory, std::filesystem::path("..")) != directory.end()) {
+      return tl::make_unexpected(
+          fmt::format("The profile directory '{}' must be relative to the device, and "
+                      "stay within it.",
+                      directory.string()));
+    }
+    if (std::ranges::find(parsed.profiles.begin(), profile_it, directory,
+                          &Output_profile::directory) != profile_it) {
+      return tl::make_unexpected(fmt::format(
+          "Several profiles are written into the directory '{}'.", directory.string()));
+    }
+    REQ(verify_options({.prog_args = ctx.prog_args,
+                        .parsed_args = profile_arguments(parsed, *profile_it)})
+            .map_error([&](const auto& err) {
+              return fmt::format("In the profile {}: {}", directory.string(), err);
+            }))
+  }
+  if (!parsed.profiles.empty()) {
+    if (parsed.resume) {
+      return tl::make_unexpected(
+          "Profiles are converted together, and can't be resumed.");
+    }
+    return ctx;
+  }
+
+  // watched devices are written from audio converted up front, as they're inserted
+  if (parsed.watch && parsed.mmap) {
+    return tl::make_unexpected(
+        "Watched devices are written from memory, and can't be encoded into "
+        "memory-mapped files.");
+  } else if (parsed.watch && parsed.resume) {
+    return tl::make_unexpected(
+        "Watched devices are written afresh, and can't be resumed.");
+  }
+
+  // check that a section of audio remains to be converted
+  if (parsed.time_range.duration == 0.0) {
+    return tl::make_unexpected("The duration of converted audio must be positive.");
+  }
+
   // check that the word size can be written by cyrus
   if (const auto word_sizes = {1, 2, 4, 8};
       std::ranges::find(word_sizes, parsed.word_size) == word_sizes.end()) {
@@ -191,9 +448,36 @@ struct Parse_context {
         parsed.range_min, parsed.range_max, parsed.range_max, parsed.range_min));
   }
 
+  // check that packed samples have a width cyrus can pack
+  if (parsed.bits < 0 || parsed.bits > max_packed_bits) {
+    return tl::make_unexpected(fmt::format(
+        "Cannot pack audio samples to a width of {} bits. Must be within 1-{}.",
+        parsed.bits, max_packed_bits));
+  }
+  if (const auto packed_max = (std::uint64_t(1) << parsed.bits) - 1u;
+      parsed.bits > 0 && packed_max < parsed.range_max) {
+    return tl::make_unexpected(
+        fmt::format("The output range maximum, {}, cannot be packed into {} bits",
+                    parsed.range_max, parsed.bits));
+  }
+
+  // check that write units cover whole sectors
+  if (parsed.write_unit < 0 || parsed.write_unit % write_unit_granularity != 0) {
+    return tl::make_unexpected(
+        fmt::format("The write unit of {} bytes must be a multiple of {} bytes.",
+                    parsed.write_unit, write_unit_granularity));
+  }
+
+  // a bundle is written in a single pass, once every clip is converted
+  if (parsed.bundle && parsed.mmap) {
+    return tl::make_unexpected("A bundle can't be encoded into memory-mapped files.");
+  } else if (parsed.bundle && parsed.resume) {
+    return tl::make_unexpected("A bundle is written whole, and can't be resumed.");
+  }
+
   // check the provided enlarge range
   if (const auto word_max = (std::uint64_t(1) << parsed.word_size * 8) - 1u;
-      word_max < parsed.range_max) {
+      parsed.bits == 0 && word_max < parsed.range_max) {
     return tl::make_unexpected(
         "Cyrus can only generate unsigned values and the minimum range value can "
         "therefore be no less than 0");
@@ -205,7 +489,9 @@ struct Parse_context {
 [[nodiscard]] tl::expected<Parse_context, std::string> parse_block_device(
     Parse_context ctx) {
   const auto prog_args = ctx.prog_args;
-  if (!prog_args.empty()) {
+  if (ctx.parsed_args.watch) {
+    return ctx;  // devices are announced by events instead
+  } else if (!prog_args.empty()) {
     ctx.parsed_args.block_device = prog_args.front();
   } else {
     return tl::make_unexpected(
@@ -223,7 +509,29 @@ struct Parse_context {
   if (const auto prog_args = ctx.prog_args; !prog_args.empty()) {
     parsed_args.audio_files.reserve(prog_args.size());
     for (const auto arg : prog_args) {
-      parsed_args.audio_files.emplace_back(arg);
+      // files may be suffixed with their own time range, unless the suffix is part of
+      // an existing file's name
+      const auto delimiter_idx = arg.rfind(file_time_range_delimiter);
+      if (delimiter_idx == std::string_view::npos || std::filesystem::exists(arg)) {
+        parsed_args.audio_files.emplace_back(arg);
+        continue;
+      }
+
+      const auto audio_file = arg.substr(0, delimiter_idx);
+      const auto range_arg = arg.substr(delimiter_idx + 1);
+      const auto comma_idx = range_arg.find(',');
+      Time_range time_range{.start = TRY(next_arg_to_seconds(
+                                std::array{arg, range_arg.substr(0, comma_idx)}, "start"))};
+      if (comma_idx != std::string_view::npos) {
+        time_range.duration = TRY(next_arg_to_seconds(
+            std::array{arg, range_arg.substr(comma_idx + 1)}, "duration"));
+        if (time_range.duration == 0.0) {
+          return tl::make_unexpected(fmt::format(
+              "The duration of converted audio must be positive, in {}.", arg));
+        }
+      }
+      parsed_args.audio_files.emplace_back(audio_file);
+      parsed_args.file_time_ranges.insert_or_assign(audio_file, time_range);
     }
   } else {
     return tl::make_unexpected("At least one input audio file must be provided.");
@@ -232,20 +540,95 @@ struct Parse_context {
   return Parse_context{.prog_args = {}, .parsed_args = parsed_args};
 }
 
+[[nodiscard]] tl::expected<Parse_context, std::string> verify_stdio(
+    const Parse_context& ctx) {
+  const auto& parsed = ctx.parsed_args;
+  const auto num_stdin = std::ranges::count(parsed.audio_files, stdio_path);
+
+  if (parsed.block_device != stdio_path) {
+    if (num_stdin > 0) {
+      return tl::make_unexpected(
+          "Audio can only be read from stdin when streaming words to stdout.");
+    }
+    return ctx;
+  }
+
+  // streamed audio is never held in whole, nor written anywhere it can be read back
+  if (num_stdin > 1) {
+    return tl::make_unexpected("Audio can only be read from stdin once.");
+  } else if (parsed.enlarge) {
+    return tl::make_unexpected(
+        "Audio can't be enlarged when streaming to stdout, as enlarging requires the "
+        "entire waveform.");
+  } else if (parsed.verify) {
+    return tl::make_unexpected("Words streamed to stdout can't be verified.");
+  } else if (parsed.resume) {
+    return tl::make_unexpected("Streaming to stdout can't be resumed.");
+  } else if (parsed.bundle) {
+    return tl::make_unexpected("Streamed words can't be bundled.");
+  } else if (parsed.mmap) {
+    return tl::make_unexpected("Words streamed to stdout can't be memory-mapped.");
+  } else if (parsed.write_unit > 0) {
+    return tl::make_unexpected("Write units only apply when writing to a device.");
+  } else if (!parsed.profiles.empty()) {
+    return tl::make_unexpected("Profiles are written into directories of a device.");
+  } else if (parsed.time_range != Time_range{} || !parsed.file_time_ranges.empty()) {
+    return tl::make_unexpected("Sections of audio are only extracted onto a device.");
+  }
+  return ctx;
+}
 
 }  // namespace
 
 std::string help_message() {
   using namespace fmt::literals;
   return fmt::format(
-      help_message_fmt, "help"_a = help_flags.flag, "help_long"_a = help_flags.long_flag,
+      help_message_fmt, "stdio"_a = stdio_path, "help"_a = help_flags.flag,
+      "help_long"_a = help_flags.long_flag,
       "word"_a = word_size_flags.flag, "word_long"_a = word_size_flags.long_flag,
       "range"_a = range_flags.flag, "range_long"_a = range_flags.long_flag,
       "range_min_default"_a = default_range_min,
       "range_max_default"_a = default_range_max, "word_default"_a = default_word_size,
       "rate"_a = sample_rate_flags.flag, "rate_long"_a = sample_rate_flags.long_flag,
       "rate_default"_a = default_sample_rate, "enlarge"_a = enlarge_flags.flag,
-      "enlarge_long"_a = enlarge_flags.long_flag);
+      "enlarge_long"_a = enlarge_flags.long_flag, "endian"_a = endian_flags.flag,
+      "endian_long"_a = endian_flags.long_flag,
+      "endian_default"_a = std::endian::native == std::endian::big ? "big" : "little",
+      "bits"_a = bits_flags.flag, "bits_long"_a = bits_flags.long_flag,
+      "bits_max"_a = max_packed_bits, "verify"_a = verify_flags.flag,
+      "verify_long"_a = verify_flags.long_flag, "resume"_a = resume_flags.flag,
+      "resume_long"_a = resume_flags.long_flag, "mmap"_a = mmap_flags.flag,
+      "mmap_long"_a = mmap_flags.long_flag, "bundle"_a = bundle_flags.flag,
+      "bundle_long"_a = bundle_flags.long_flag, "bundle_file"_a = bundle_file_name,
+      "quality"_a = quality_flags.flag, "quality_long"_a = quality_flags.long_flag,
+      "kernels"_a = kernels_flags.flag, "kernels_long"_a = kernels_flags.long_flag,
+      "stats"_a = stats_flags.flag, "stats_long"_a = stats_flags.long_flag,
+      "write_unit"_a = write_unit_flags.flag,
+      "write_unit_long"_a = write_unit_flags.long_flag,
+      "write_unit_granularity"_a = write_unit_granularity,
+      "profile"_a = profile_flags.flag, "profile_long"_a = profile_flags.long_flag,
+      "at"_a = file_time_range_delimiter, "start"_a = start_flags.flag,
+      "start_long"_a = start_flags.long_flag, "duration"_a = duration_flags.flag,
+      "duration_long"_a = duration_flags.long_flag, "watch"_a = watch_flags.flag,
+      "watch_long"_a = watch_flags.long_flag, "netlink"_a = netlink_event_source);
+}
+
+Time_range audio_time_range(const Parsed_arguments& args,
+                            const std::filesystem::path& audio_file) {
+  const auto range_it = args.file_time_ranges.find(audio_file);
+  return range_it == args.file_time_ranges.end() ? args.time_range : range_it->second;
+}
+
+Parsed_arguments profile_arguments(const Parsed_arguments& args,
+                                   const Output_profile& profile) {
+  Parsed_arguments profile_args = args;
+  profile_args.profiles.clear();
+  profile_args.word_size = profile.word_size.value_or(args.word_size);
+  std::tie(profile_args.range_min, profile_args.range_max) =
+      profile.range.value_or(std::pair{args.range_min, args.range_max});
+  profile_args.sample_rate = profile.sample_rate.value_or(args.sample_rate);
+  profile_args.enlarge = profile.enlarge.value_or(args.enlarge);
+  return profile_args;
 }
 
 tl::expected<Parsed_arguments, std::string> parse_arguments(
@@ -258,7 +641,8 @@ tl::expected<Parsed_arguments, std::string> parse_arguments(
         }
         return verify_options(ctx)
             .and_then(parse_block_device)
-            .and_then(parse_audio_files);
+            .and_then(parse_audio_files)
+            .and_then(verify_stdio);
       })
       .map([](const auto c) { return c.parsed_args; });
 }
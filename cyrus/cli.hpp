@@ -1,10 +1,15 @@
 #pragma once
 
+#include <bit>
+#include <cyrus/cpu_kernels.hpp>
 #include <cyrus/cyrus_main.hpp>
 #include <filesystem>
+#include <map>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <tl/expected.hpp>
+#include <utility>
 #include <vector>
 
 namespace cyrus {
@@ -14,6 +19,30 @@ constexpr const int default_sample_rate{40000};
 constexpr const uint64_t default_range_max{3890};
 constexpr const uint64_t default_range_min{205};
 
+// names stdin when given as an audio file, and stdout when given as the block device
+constexpr const std::string_view stdio_path{"-"};
+
+// libsamplerate sinc converter used to resample audio
+enum class Resample_quality { fastest, medium, best, automatic };
+
+// Output written into its own directory of the device, converted from the same decoded
+// audio as every other profile. Unset options take the value shared by all profiles.
+struct Output_profile {
+  std::filesystem::path directory{};  // relative to the device's mount point
+  std::optional<int> word_size{};
+  std::optional<std::pair<uint64_t, uint64_t>> range{};  // min, max
+  std::optional<int> sample_rate{};
+  std::optional<bool> enlarge{};
+};
+
+// section of an audio file to convert, in seconds
+struct Time_range {
+  double start{0.0};
+  std::optional<double> duration{};  // through the end of the file when unset
+
+  friend bool operator==(const Time_range&, const Time_range&) = default;
+};
+
 struct Parsed_arguments {
   std::filesystem::path block_device{};
   std::vector<std::filesystem::path> audio_files{};
@@ -23,8 +52,32 @@ struct Parsed_arguments {
   uint64_t range_min{default_range_min};
   int sample_rate{default_sample_rate};
   bool enlarge{false};
+  std::endian endian{std::endian::native};
+  int bits{0};  // when non-zero, bit-pack samples rather than writing whole words
+  bool verify{false};
+  bool resume{false};
+  bool mmap{false};  // encode straight into memory-mapped destination files
+  bool bundle{false};  // write every clip into a single indexed file
+  Resample_quality quality{Resample_quality::automatic};
+  std::optional<Kernel_variant> kernels{};  // overrides the dispatched kernel variant
+  bool stats{false};
+  int write_unit{0};  // bytes per aligned write unit, or 0 to size them from the device
+  std::vector<Output_profile> profiles{};
+  Time_range time_range{};
+  std::map<std::filesystem::path, Time_range> file_time_ranges{};  // override time_range
+  // when set, write every block device announced by this event source, rather than
+  // block_device
+  std::optional<std::string> watch{};
 };
 
+// the section of an audio file that's converted
+[[nodiscard]] Time_range audio_time_range(const Parsed_arguments& args,
+                                          const std::filesystem::path& audio_file);
+
+// the arguments a profile's output is converted with
+[[nodiscard]] Parsed_arguments profile_arguments(const Parsed_arguments& args,
+                                                 const Output_profile& profile);
+
 std::string help_message();
 
 [[nodiscard]] tl::expected<Parsed_arguments, std::string> parse_arguments(
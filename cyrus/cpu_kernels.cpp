@@ -0,0 +1,272 @@
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cyrus/cpu_kernels.hpp>
+#include <cyrus/sample_conversions.hpp>
+
+namespace cyrus {
+
+namespace {
+
+// stereo frames staged per block of a downmix, small enough to stay in L1
+constexpr std::size_t downmix_block_frames{256};
+// independent running minima and maxima, enough to fill an AVX-512 register
+constexpr std::size_t min_max_lanes{16};
+
+// Kernel bodies are always inlined into each variant's entry points, so they're
+// compiled, and vectorized, for that variant's instruction set.
+
+[[gnu::always_inline]] inline void downmix_stereo_body(
+    const std::span<const float> interleaved, const std::span<float> mono) noexcept {
+  // frames are staged through a local block, as mono may overlap interleaved
+  std::array<float, 2 * downmix_block_frames> block;
+  for (std::size_t start = 0; start < mono.size(); start += downmix_block_frames) {
+    const auto count = std::min(downmix_block_frames, mono.size() - start);
+    std::copy_n(interleaved.data() + 2 * start, 2 * count, block.data());
+    auto* const out = mono.data() + start;
+    for (std::size_t i = 0; i < count; ++i) {
+      // equals std::midpoint for samples that can't overflow when summed
+      out[i] = (block[2 * i] + block[2 * i + 1]) * 0.5f;
+    }
+  }
+}
+
+[[gnu::always_inline]] inline std::pair<float, float> min_max_body(
+    const std::span<const float> samples) noexcept {
+  if (samples.empty()) {
+    return {0.0f, 0.0f};
+  }
+
+  std::array<float, min_max_lanes> lows;
+  std::array<float, min_max_lanes> highs;
+  lows.fill(samples.front());
+  highs.fill(samples.front());
+  std::size_t i = 0;
+  for (; i + min_max_lanes <= samples.size(); i += min_max_lanes) {
+    for (std::size_t lane = 0; lane < min_max_lanes; ++lane) {
+      const auto sample = samples[i + lane];
+      lows[lane] = sample < lows[lane] ? sample : lows[lane];
+      highs[lane] = highs[lane] < sample ? sample : highs[lane];
+    }
+  }
+  for (; i < samples.size(); ++i) {
+    lows[0] = std::min(lows[0], samples[i]);
+    highs[0] = std::max(highs[0], samples[i]);
+  }
+  return {*std::ranges::min_element(lows), *std::ranges::max_element(highs)};
+}
+
+template <std::unsigned_integral To>
+[[gnu::always_inline]] inline void remap_body(const std::span<const float> in,
+                                              const double scale, const double shift,
+                                              const std::span<To> out) noexcept {
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    out[i] = static_cast<To>(scale * static_cast<double>(in[i]) + shift);
+  }
+}
+
+template <std::unsigned_integral U>
+[[nodiscard]] constexpr U byte_swapped(const U word) noexcept {
+  if constexpr (sizeof(U) == 2) {
+    return __builtin_bswap16(word);
+  } else if constexpr (sizeof(U) == 4) {
+    return __builtin_bswap32(word);
+  } else {
+    return __builtin_bswap64(word);
+  }
+}
+
+template <std::unsigned_integral U>
+[[gnu::always_inline]] inline void flip_endianness_body(
+    const std::span<U> words) noexcept {
+  for (auto& word : words) {
+    word = byte_swapped(word);
+  }
+}
+
+struct Kernel_table {
+  void (*downmix_stereo)(std::span<const float>, std::span<float>) noexcept;
+  std::pair<float, float> (*min_max)(std::span<const float>) noexcept;
+  void (*remap_u8)(std::span<const float>, double, double,
+                   std::span<std::uint8_t>) noexcept;
+  void (*remap_u16)(std::span<const float>, double, double,
+                    std::span<std::uint16_t>) noexcept;
+  void (*remap_u32)(std::span<const float>, double, double,
+                    std::span<std::uint32_t>) noexcept;
+  void (*remap_u64)(std::span<const float>, double, double,
+                    std::span<std::uint64_t>) noexcept;
+  void (*flip_u16)(std::span<std::uint16_t>) noexcept;
+  void (*flip_u32)(std::span<std::uint32_t>) noexcept;
+  void (*flip_u64)(std::span<std::uint64_t>) noexcept;
+};
+
+// Defines a variant's entry points, each compiled with the given attributes, and
+// its table of them. Variants never enable FMA, so that every variant rounds
+// remapped samples identically.
+#define CYRUS_DEFINE_KERNEL_VARIANT(variant, flip_body, ...)                             \
+  namespace variant {                                                                    \
+  [[__VA_ARGS__]] void downmix_stereo(const std::span<const float> interleaved,          \
+                                      const std::span<float> mono) noexcept {            \
+    downmix_stereo_body(interleaved, mono);                                              \
+  }                                                                                      \
+  [[__VA_ARGS__]] std::pair<float, float> min_max(                                       \
+      const std::span<const float> samples) noexcept {                                   \
+    return min_max_body(samples);                                                        \
+  }                                                                                      \
+  template <std::unsigned_integral To>                                                   \
+  [[__VA_ARGS__]] void remap(const std::span<const float> in, const double scale,        \
+                             const double shift, const std::span<To> out) noexcept {     \
+    remap_body<To>(in, scale, shift, out);                                               \
+  }                                                                                      \
+  template <std::unsigned_integral U>                                                    \
+  [[__VA_ARGS__]] void flip_endianness(const std::span<U> words) noexcept {              \
+    flip_body<U>(words);                                                                 \
+  }                                                                                      \
+  constexpr Kernel_table table{&downmix_stereo,                                          \
+                               &min_max,                                                 \
+                               &remap<std::uint8_t>,                                     \
+                               &remap<std::uint16_t>,                                    \
+                               &remap<std::uint32_t>,                                    \
+                               &remap<std::uint64_t>,                                    \
+                               &flip_endianness<std::uint16_t>,                          \
+                               &flip_endianness<std::uint32_t>,                          \
+                               &flip_endianness<std::uint64_t>};                         \
+  }
+
+// the baseline keeps the SSE2 byte swap, which compilers can't derive from bswap
+CYRUS_DEFINE_KERNEL_VARIANT(baseline, cyrus::flip_endianness, )
+#if defined(__x86_64__)
+CYRUS_DEFINE_KERNEL_VARIANT(avx2, flip_endianness_body, gnu::target("avx2"))
+CYRUS_DEFINE_KERNEL_VARIANT(avx512, flip_endianness_body,
+                            gnu::target("avx512f,avx512bw,avx512dq,avx512vl"))
+#endif
+
+#undef CYRUS_DEFINE_KERNEL_VARIANT
+
+[[nodiscard]] const Kernel_table& variant_table(const Kernel_variant variant) noexcept {
+  switch (variant) {
+#if defined(__x86_64__)
+    case Kernel_variant::avx2:
+      return avx2::table;
+    case Kernel_variant::avx512:
+      return avx512::table;
+#endif
+    default:
+      return baseline::table;
+  }
+}
+
+struct Active_kernels {
+  std::atomic<Kernel_variant> variant{supported_kernel_variant()};
+  std::atomic<const Kernel_table*> table{&variant_table(variant)};
+};
+
+[[nodiscard]] Active_kernels& active_kernels() noexcept {
+  static Active_kernels active;
+  return active;
+}
+
+[[nodiscard]] const Kernel_table& active_table() noexcept {
+  return *active_kernels().table.load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+std::string_view kernel_variant_name(const Kernel_variant variant) noexcept {
+  switch (variant) {
+    case Kernel_variant::avx2:
+      return "avx2";
+    case Kernel_variant::avx512:
+      return "avx512";
+    default:
+#if defined(__x86_64__)
+      return "sse2";
+#else
+      return "baseline";
+#endif
+  }
+}
+
+Kernel_variant supported_kernel_variant() noexcept {
+#if defined(__x86_64__)
+  static const auto supported = [] {
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+      return Kernel_variant::avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+      return Kernel_variant::avx2;
+    }
+    return Kernel_variant::baseline;
+  }();
+  return supported;
+#else
+  return Kernel_variant::baseline;
+#endif
+}
+
+Kernel_variant active_kernel_variant() noexcept {
+  return active_kernels().variant.load(std::memory_order_relaxed);
+}
+
+tl::expected<void, std::string> select_kernel_variant(const Kernel_variant variant) {
+  if (variant > supported_kernel_variant()) {
+    return tl::make_unexpected(
+        fmt::format("This CPU doesn't support {} kernels. At most {} are supported.",
+                    kernel_variant_name(variant),
+                    kernel_variant_name(supported_kernel_variant())));
+  }
+  active_kernels().variant.store(variant, std::memory_order_relaxed);
+  active_kernels().table.store(&variant_table(variant), std::memory_order_relaxed);
+  return {};
+}
+
+namespace kernels {
+
+void downmix_stereo(const std::span<const float> interleaved,
+                    const std::span<float> mono) noexcept {
+  active_table().downmix_stereo(interleaved, mono);
+}
+
+std::pair<float, float> min_max(const std::span<const float> samples) noexcept {
+  return active_table().min_max(samples);
+}
+
+void remap(const std::span<const float> in, const double scale, const double shift,
+           const std::span<std::uint8_t> out) noexcept {
+  active_table().remap_u8(in, scale, shift, out);
+}
+
+void remap(const std::span<const float> in, const double scale, const double shift,
+           const std::span<std::uint16_t> out) noexcept {
+  active_table().remap_u16(in, scale, shift, out);
+}
+
+void remap(const std::span<const float> in, const double scale, const double shift,
+           const std::span<std::uint32_t> out) noexcept {
+  active_table().remap_u32(in, scale, shift, out);
+}
+
+void remap(const std::span<const float> in, const double scale, const double shift,
+           const std::span<std::uint64_t> out) noexcept {
+  active_table().remap_u64(in, scale, shift, out);
+}
+
+void flip_endianness(const std::span<std::uint16_t> words) noexcept {
+  active_table().flip_u16(words);
+}
+
+void flip_endianness(const std::span<std::uint32_t> words) noexcept {
+  active_table().flip_u32(words);
+}
+
+void flip_endianness(const std::span<std::uint64_t> words) noexcept {
+  active_table().flip_u64(words);
+}
+
+}  // namespace kernels
+
+}  // namespace cyrus
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tl/expected.hpp>
+#include <utility>
+
+namespace cyrus {
+
+// Instruction set extensions that the hot sample kernels are compiled for. Every
+// variant is built into the one binary, and the best the running CPU supports is
+// dispatched to. The baseline is SSE2 on x86-64, and portable C++ elsewhere.
+enum class Kernel_variant { baseline, avx2, avx512 };
+
+[[nodiscard]] std::string_view kernel_variant_name(Kernel_variant) noexcept;
+
+// the best variant the running CPU supports
+[[nodiscard]] Kernel_variant supported_kernel_variant() noexcept;
+
+// the variant kernels dispatch to, the supported one unless overridden
+[[nodiscard]] Kernel_variant active_kernel_variant() noexcept;
+
+// overrides the variant kernels dispatch to, which the running CPU must support
+[[nodiscard]] tl::expected<void, std::string> select_kernel_variant(Kernel_variant);
+
+namespace kernels {
+
+// averages every interleaved stereo frame into a mono sample. mono may overlap the
+// start of interleaved, so a signal can be downmixed in place.
+void downmix_stereo(std::span<const float> interleaved, std::span<float> mono) noexcept;
+
+// smallest and largest sample, or zeros when there are none
+[[nodiscard]] std::pair<float, float> min_max(std::span<const float> samples) noexcept;
+
+// out[i] = scale * in[i] + shift, truncated to a word as Sample_remapper does
+void remap(std::span<const float> in, double scale, double shift,
+           std::span<std::uint8_t> out) noexcept;
+void remap(std::span<const float> in, double scale, double shift,
+           std::span<std::uint16_t> out) noexcept;
+void remap(std::span<const float> in, double scale, double shift,
+           std::span<std::uint32_t> out) noexcept;
+void remap(std::span<const float> in, double scale, double shift,
+           std::span<std::uint64_t> out) noexcept;
+
+// reverses the byte order of every word in place
+void flip_endianness(std::span<std::uint16_t> words) noexcept;
+void flip_endianness(std::span<std::uint32_t> words) noexcept;
+void flip_endianness(std::span<std::uint64_t> words) noexcept;
+
+}  // namespace kernels
+
+}  // namespace cyrus
@@ -1,11 +1,27 @@
 #include <fmt/core.h>
 
+#include <cstdio>
+#include <cyrus/audio_signal.hpp>
+#include <cyrus/checksum.hpp>
 #include <cyrus/cli.hpp>
+#include <cyrus/cpu_kernels.hpp>
 #include <cyrus/cyrus_main.hpp>
+#include <cyrus/stream_audio.hpp>
 #include <cyrus/write_audio.hpp>
 
 namespace cyrus {
 
+namespace {
+
+void print_stats(std::FILE* const out) {
+  fmt::print(out, "Kernels: {} (best supported {}), CRC32C: {}, resample threads: {}\n",
+             kernel_variant_name(active_kernel_variant()),
+             kernel_variant_name(supported_kernel_variant()), crc32c_implementation(),
+             detail::available_threads());
+}
+
+}  // namespace
+
 int cmain(const Program_arguments prog_args) {
   const auto parsed =
       cyrus::parse_arguments(prog_args).map_error([](const auto& err_msg) {
@@ -21,7 +37,32 @@ int cmain(const Program_arguments prog_args) {
     return 0;
   }
 
-  if (const auto w = cyrus::write_audio_to_device(parsed_args); !w) {
+  if (parsed_args.kernels) {
+    if (const auto s = select_kernel_variant(*parsed_args.kernels); !s) {
+      fmt::print(stderr, "{}\n", s.error());
+      return 1;
+    }
+  }
+
+  // progress is reported on stderr when stdout carries the written words
+  if (parsed_args.block_device == stdio_path) {
+    if (parsed_args.stats) {
+      print_stats(stderr);
+    }
+    if (const auto s = cyrus::stream_audio_to_stdout(parsed_args); !s) {
+      fmt::print(stderr, "{}\n", s.error());
+      return 1;
+    }
+    fmt::print(stderr, "Done.\n");
+    return 0;
+  }
+
+  if (parsed_args.stats) {
+    print_stats(stdout);
+  }
+  if (const auto w = parsed_args.watch ? cyrus::watch_devices(parsed_args)
+                                       : cyrus::write_audio_to_device(parsed_args);
+      !w) {
     fmt::print(stderr, "{}\n", w.error());
     return 1;
   }
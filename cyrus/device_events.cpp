@@ -0,0 +1,125 @@
+#include <fmt/core.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <cyrus/device_events.hpp>
+#include <cyrus/try.hpp>
+#include <memory>
+#include <string>
+
+namespace cyrus {
+
+namespace {
+
+// multicast group the kernel broadcasts uevents to, as opposed to udev's
+constexpr unsigned kernel_uevent_group{1};
+// the kernel limits each uevent to 2 KiB
+constexpr std::size_t uevent_buffer_size{std::size_t{4} << 10};
+
+}  // namespace
+
+Device_event parse_uevent(std::string_view uevent) {
+  Device_event event;
+  while (!uevent.empty()) {
+    const auto field_end = uevent.find_first_of(std::string_view{"\0 \t\n", 4});
+    const auto field = uevent.substr(0, field_end);
+    uevent.remove_prefix(std::min(field.size() + 1, uevent.size()));
+
+    const auto equals_idx = field.find('=');
+    if (equals_idx == std::string_view::npos) {
+      continue;
+    }
+    const auto key = field.substr(0, equals_idx);
+    const auto value = std::string(field.substr(equals_idx + 1));
+    if (key == "ACTION") {
+      event.action = value;
+    } else if (key == "SUBSYSTEM") {
+      event.subsystem = value;
+    } else if (key == "DEVTYPE") {
+      event.devtype = value;
+    } else if (key == "DEVNAME") {
+      event.devname = value;
+    }
+  }
+  return event;
+}
+
+tl::expected<Netlink_event_source, std::string> Netlink_event_source::open() {
+  Unique_fd socket(
+      ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT));
+  if (!socket) {
+    return tl::make_unexpected(fmt::format("Failed to open a uevent netlink socket: {}",
+                                           std::strerror(errno)));
+  }
+
+  sockaddr_nl address{};
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = kernel_uevent_group;
+  if (::bind(socket.get(), reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) != 0) {
+    return tl::make_unexpected(fmt::format(
+        "Failed to listen for the kernel's uevents: {}", std::strerror(errno)));
+  }
+  return Netlink_event_source(std::move(socket));
+}
+
+tl::expected<std::optional<Device_event>, std::string> Netlink_event_source::next() {
+  std::array<char, uevent_buffer_size> buffer;
+  while (true) {
+    sockaddr_nl sender{};
+    socklen_t sender_size = sizeof(sender);
+    const auto received =
+        ::recvfrom(_socket.get(), buffer.data(), buffer.size(), 0,
+                   reinterpret_cast<sockaddr*>(&sender), &sender_size);
+    if (received < 0) {
+      // events that overran the socket's buffer are lost, but later ones still arrive
+      if (errno == EINTR || errno == ENOBUFS) {
+        continue;
+      }
+      return tl::make_unexpected(
+          fmt::format("Failed to receive a uevent: {}", std::strerror(errno)));
+    }
+
+    // only the kernel's own messages are trusted
+    if (sender.nl_pid == 0) {
+      return parse_uevent({buffer.data(), static_cast<std::size_t>(received)});
+    }
+  }
+}
+
+tl::expected<File_event_source, std::string> File_event_source::open(
+    const std::string& path) {
+  std::ifstream events(path);
+  if (!events.is_open()) {
+    return tl::make_unexpected(
+        fmt::format("Failed to open the device events in {}", path));
+  }
+  return File_event_source(std::move(events));
+}
+
+tl::expected<std::optional<Device_event>, std::string> File_event_source::next() {
+  std::string line;
+  while (std::getline(_events, line)) {
+    if (!line.empty()) {
+      return parse_uevent(line);
+    }
+  }
+  if (_events.bad()) {
+    return tl::make_unexpected("Failed to read the next device event.");
+  }
+  return std::nullopt;
+}
+
+tl::expected<std::unique_ptr<Device_event_source>, std::string>
+open_device_event_source(const std::string& source) {
+  if (source == netlink_event_source) {
+    return std::make_unique<Netlink_event_source>(TRY(Netlink_event_source::open()));
+  }
+  return std::make_unique<File_event_source>(TRY(File_event_source::open(source)));
+}
+
+}  // namespace cyrus
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cyrus/unique_fd.hpp>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tl/expected.hpp>
+#include <utility>
+
+namespace cyrus {
+
+// names the kernel's netlink uevent socket as a device event source
+constexpr const std::string_view netlink_event_source{"netlink"};
+
+// a uevent announcing a change to a device
+struct Device_event {
+  std::string action{};     // add, remove, change...
+  std::string subsystem{};  // block, usb...
+  std::string devtype{};    // disk or partition, for block devices
+  std::string devname{};    // name of the device's node under /dev
+};
+
+// Parses a uevent's KEY=VALUE fields, separated by NULs as the kernel sends them, or
+// by whitespace as they're written by hand. Other fields, and the kernel's leading
+// action@devpath summary, are ignored.
+[[nodiscard]] Device_event parse_uevent(std::string_view);
+
+// delivers device events in the order they occur
+class Device_event_source {
+ public:
+  // the next event, waiting for one to occur, or nullopt once no more will
+  virtual tl::expected<std::optional<Device_event>, std::string> next() = 0;
+  virtual ~Device_event_source() noexcept = default;
+};
+
+// events broadcast by the kernel over a netlink uevent socket
+class Netlink_event_source : public Device_event_source {
+ private:
+  Unique_fd _socket;
+
+  explicit Netlink_event_source(Unique_fd socket) noexcept : _socket{std::move(socket)} {}
+
+ public:
+  [[nodiscard]] static tl::expected<Netlink_event_source, std::string> open();
+
+  tl::expected<std::optional<Device_event>, std::string> next() override;
+};
+
+// Events read one per line from a file or FIFO, standing in for the kernel's. Each
+// line holds the fields of a uevent, such as
+// "ACTION=add SUBSYSTEM=block DEVTYPE=partition DEVNAME=sdb1".
+class File_event_source : public Device_event_source {
+ private:
+  std::ifstream _events;
+
+  explicit File_event_source(std::ifstream events) : _events{std::move(events)} {}
+
+ public:
+  [[nodiscard]] static tl::expected<File_event_source, std::string> open(
+      const std::string& path);
+
+  tl::expected<std::optional<Device_event>, std::string> next() override;
+};
+
+// the kernel's events when named by netlink_event_source, otherwise those read from
+// the named file
+[[nodiscard]] tl::expected<std::unique_ptr<Device_event_source>, std::string>
+open_device_event_source(const std::string& source);
+
+}  // namespace cyrus
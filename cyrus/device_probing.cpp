@@ -15,7 +15,18 @@ namespace cyrus {
 
 namespace {
 const constexpr char delim = ' ';
+
+// sysfs reports partition offsets in 512 byte sectors, regardless of the device
+constexpr std::uint64_t sysfs_sector_size{512};
+
+template <typename T>
+void read_sysfs_value(const fs::path& path, T& value) {
+  std::fstream attribute(path, std::ios_base::in);
+  if (T read_value; attribute >> read_value) {
+    value = read_value;
+  }
 }
+}  // namespace
 
 tl::expected<Mountings, std::error_code> read_mounting(
     const std::filesystem::path& block_device) {
@@ -119,5 +130,27 @@ std::vector<fs::path> read_drive_partitions(const std::filesystem::path& block_d
   return drive_partitions;
 }
 
+Device_geometry read_device_geometry(const std::filesystem::path& block_device) {
+  Device_geometry geometry;
+  std::error_code ec;
+  const auto device_name = fs::canonical(block_device, ec).filename();
+  const auto sys_device = fs::canonical(fs::path("/sys/class/block") / device_name, ec);
+  if (ec) {
+    return geometry;
+  }
+
+  // a partition's queue is its drive's, whose sysfs directory contains the partition's
+  const auto is_partition = fs::exists(sys_device / "partition", ec);
+  const auto queue = (is_partition ? sys_device.parent_path() : sys_device) / "queue";
+  read_sysfs_value(queue / "physical_block_size", geometry.physical_block_size);
+  read_sysfs_value(queue / "minimum_io_size", geometry.minimum_io_size);
+  read_sysfs_value(queue / "optimal_io_size", geometry.optimal_io_size);
+  if (is_partition) {
+    read_sysfs_value(sys_device / "start", geometry.partition_start);
+    geometry.partition_start *= sysfs_sector_size;
+  }
+  return geometry;
+}
+
 
 }  // namespace cyrus
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <map>
 #include <string>
@@ -24,4 +25,16 @@ using Mountings = std::map<std::filesystem::path, Mounting>;
 [[nodiscard]] std::vector<std::filesystem::path> read_drive_partitions(
     const std::filesystem::path&);
 
+// I/O geometry of a block device's queue, in bytes, as reported under /sys/block
+struct Device_geometry {
+  std::size_t physical_block_size{512};
+  std::size_t minimum_io_size{512};
+  std::size_t optimal_io_size{0};  // 0 when the device doesn't report one
+  std::uint64_t partition_start{0};  // offset of the partition from its drive's start
+};
+
+// reads the geometry of a block device, or of the drive of a partition. Values
+// the kernel doesn't report keep their defaults.
+[[nodiscard]] Device_geometry read_device_geometry(const std::filesystem::path&);
+
 }  // namespace cyrus
@@ -0,0 +1,136 @@
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>  // SEEK_SET, SEEK_CUR, SEEK_END
+#include <cstring>
+#include <cyrus/input_prefetch.hpp>
+#include <cyrus/unique_fd.hpp>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace cyrus {
+
+namespace {
+
+constexpr std::size_t read_chunk_size{std::size_t{1} << 20};
+
+Memory_source& source(void* user_data) {
+  return *static_cast<Memory_source*>(user_data);
+}
+
+// asks the kernel to start reading a file into the page cache, without waiting
+void hint_will_need(const fs::path& path) {
+  if (const Unique_fd fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)); fd) {
+    ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_WILLNEED);
+  }
+}
+
+}  // namespace
+
+tl::expected<Prefetched_file, std::string> Prefetched_file::read(const fs::path& path) {
+  const Unique_fd fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  struct stat file_stat {};
+  if (!fd || ::fstat(fd.get(), &file_stat) != 0) {
+    return tl::make_unexpected(
+        fmt::format("Couldn't open {}: {}", path, std::strerror(errno)));
+  }
+  ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  Prefetched_file file;
+  file._data.resize(static_cast<std::size_t>(file_stat.st_size));
+  std::size_t total{0};
+  while (total < file._data.size()) {
+    const auto chunk = std::min(read_chunk_size, file._data.size() - total);
+    const auto num_read = ::read(fd.get(), file._data.data() + total, chunk);
+    if (num_read < 0 && errno == EINTR) {
+      continue;
+    } else if (num_read < 0) {
+      return tl::make_unexpected(
+          fmt::format("Couldn't read {}: {}", path, std::strerror(errno)));
+    } else if (num_read == 0) {
+      break;
+    }
+    total += static_cast<std::size_t>(num_read);
+  }
+  // a file truncated while read is decoded up to where it ended
+  file._data.resize(total);
+  return file;
+}
+
+SF_VIRTUAL_IO& Memory_source::virtual_io() noexcept {
+  static SF_VIRTUAL_IO vio{
+      .get_filelen = [](void* user_data) { return source(user_data).size(); },
+      .seek = [](const sf_count_t offset, const int whence,
+                 void* user_data) { return source(user_data).seek(offset, whence); },
+      .read = [](void* ptr, const sf_count_t count,
+                 void* user_data) { return source(user_data).read(ptr, count); },
+      .write = [](const void*, sf_count_t, void*) { return sf_count_t{0}; },
+      .tell = [](void* user_data) { return source(user_data).tell(); }};
+  return vio;
+}
+
+sf_count_t Memory_source::read(void* const ptr, const sf_count_t count) noexcept {
+  const auto num_read = std::clamp(size() - _position, sf_count_t{0}, count);
+  if (num_read > 0) {
+    std::memcpy(ptr, _data.data() + _position, static_cast<std::size_t>(num_read));
+    _position += num_read;
+  }
+  return num_read;
+}
+
+sf_count_t Memory_source::seek(const sf_count_t offset, const int whence) noexcept {
+  sf_count_t target;
+  switch (whence) {
+    case SEEK_SET:
+      target = offset;
+      break;
+    case SEEK_CUR:
+      target = _position + offset;
+      break;
+    case SEEK_END:
+      target = size() + offset;
+      break;
+    default:
+      return -1;
+  }
+  if (target < 0) {
+    return -1;
+  }
+  _position = target;
+  return _position;
+}
+
+Input_prefetcher::Input_prefetcher(const std::span<const fs::path> paths)
+    : _paths{paths} {
+  for (std::size_t idx = 1; idx <= hinted_files && idx < _paths.size(); ++idx) {
+    hint_will_need(_paths[idx]);
+  }
+  prefetch(0);
+}
+
+void Input_prefetcher::prefetch(const std::size_t idx) {
+  if (idx >= _paths.size()) {
+    return;
+  }
+  _prefetching = std::async(std::launch::async, [path = _paths[idx]] {
+    return Prefetched_file::read(path);
+  });
+}
+
+tl::expected<Prefetched_file, std::string> Input_prefetcher::next() {
+  auto file = _prefetching.get();
+  ++_next_idx;
+  prefetch(_next_idx);
+  if (const auto hinted_idx = _next_idx + hinted_files; hinted_idx < _paths.size()) {
+    hint_will_need(_paths[hinted_idx]);
+  }
+  return file;
+}
+
+}  // namespace cyrus
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <sndfile.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <span>
+#include <string>
+#include <tl/expected.hpp>
+#include <vector>
+
+namespace cyrus {
+
+// an input file read whole into memory
+class Prefetched_file {
+ private:
+  std::vector<std::byte> _data{};
+
+ public:
+  // reads the file sequentially, hinting the kernel to read ahead of each read
+  [[nodiscard]] static tl::expected<Prefetched_file, std::string> read(
+      const std::filesystem::path&);
+
+  [[nodiscard]] std::span<const std::byte> data() const noexcept { return _data; }
+};
+
+// Presents bytes held in memory to libsndfile through its virtual I/O interface.
+// Several sources may read the same bytes, each from its own position.
+class Memory_source {
+ private:
+  std::span<const std::byte> _data;
+  sf_count_t _position{0};
+
+ public:
+  explicit Memory_source(const std::span<const std::byte> data) noexcept
+      : _data{data} {}
+
+  // callbacks for libsndfile, each expecting this as their user data
+  [[nodiscard]] static SF_VIRTUAL_IO& virtual_io() noexcept;
+
+  sf_count_t read(void* ptr, sf_count_t count) noexcept;
+  sf_count_t seek(sf_count_t offset, int whence) noexcept;
+  [[nodiscard]] sf_count_t tell() const noexcept { return _position; }
+  [[nodiscard]] sf_count_t size() const noexcept {
+    return static_cast<sf_count_t>(_data.size());
+  }
+};
+
+// Reads input files in order, one file ahead of the caller on a background
+// thread, so the next file's reads overlap the current file's decoding. Files
+// further ahead are hinted to the kernel, which starts reading them into the
+// page cache in the meantime.
+class Input_prefetcher {
+ private:
+  static constexpr std::size_t hinted_files{2};
+  std::span<const std::filesystem::path> _paths;
+  std::size_t _next_idx{0};
+  std::future<tl::expected<Prefetched_file, std::string>> _prefetching{};
+
+  void prefetch(std::size_t idx);
+
+ public:
+  explicit Input_prefetcher(std::span<const std::filesystem::path> paths);
+
+  // the next file in order, waiting for its prefetch to complete
+  [[nodiscard]] tl::expected<Prefetched_file, std::string> next();
+};
+
+}  // namespace cyrus
@@ -0,0 +1,121 @@
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <cyrus/checksum.hpp>
+#include <cyrus/journal.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace cyrus {
+
+namespace {
+
+constexpr const char* const journal_file_name{".cyrus_journal"};
+
+// each line is formatted as: <fingerprint> <checksum> <size> <file name>
+[[nodiscard]] std::string format_entry(const Journal_entry& entry) {
+  return fmt::format("{:08x} {:08x} {} {}\n", entry.fingerprint, entry.checksum,
+                     entry.size, entry.file_name);
+}
+
+[[nodiscard]] bool parse_entry(const std::string& line, Journal_entry& entry) {
+  std::istringstream fields(line);
+  fields >> std::hex >> entry.fingerprint >> entry.checksum >> std::dec >> entry.size;
+  if (!fields || fields.get() != ' ') {
+    return false;
+  }
+  std::getline(fields, entry.file_name);
+  return !entry.file_name.empty();
+}
+
+}  // namespace
+
+std::uint32_t conversion_fingerprint(const Parsed_arguments& args,
+                                     const fs::path& audio_file) {
+  std::error_code ec;
+  const auto file_size = fs::file_size(audio_file, ec);
+  const auto modified = fs::last_write_time(audio_file, ec).time_since_epoch().count();
+  const auto time_range = audio_time_range(args, audio_file);
+  const auto identity = fmt::format(
+      "{} {} {} w{} b{} {} r{},{} s{} e{} q{} t{},{}", fs::absolute(audio_file, ec),
+      file_size, modified, args.word_size, args.bits,
+      args.endian == std::endian::big ? "big" : "little", args.range_min, args.range_max,
+      args.sample_rate, args.enlarge, static_cast<int>(args.quality), time_range.start,
+      time_range.duration.value_or(-1.0));
+  return crc32c(std::as_bytes(std::span{identity.data(), identity.size()}));
+}
+
+Write_journal Write_journal::read(const fs::path& mount_point, const bool resume) {
+  Write_journal journal;
+  journal._path = mount_point / journal_file_name;
+
+  // entries are only appended, so a torn final line is the only possible damage
+  if (resume) {
+    std::ifstream journal_file(journal._path);
+    std::string line;
+    Journal_entry entry;
+    while (std::getline(journal_file, line)) {
+      if (parse_entry(line, entry)) {
+        journal._entries.insert_or_assign(entry.file_name, entry);
+      }
+    }
+  }
+  return journal;
+}
+
+tl::expected<void, std::string> Write_journal::open_for_recording(const bool resume) {
+  const auto mode = O_WRONLY | O_CREAT | O_APPEND | (resume ? 0 : O_TRUNC);
+  _fd.reset(::open(_path.c_str(), mode, 0644));
+  if (!_fd) {
+    return tl::make_unexpected(fmt::format("Couldn't open the write journal {}: {}",
+                                           _path, std::strerror(errno)));
+  }
+  return {};
+}
+
+const Journal_entry* Write_journal::completed(const fs::path& mount_point,
+                                              const std::string& file_name,
+                                              const std::uint32_t fingerprint) const {
+  const auto entry_it = _entries.find(file_name);
+  if (entry_it == _entries.end() || entry_it->second.fingerprint != fingerprint) {
+    return nullptr;
+  }
+
+  std::error_code ec;
+  if (const auto size = fs::file_size(mount_point / file_name, ec);
+      ec || size != entry_it->second.size) {
+    return nullptr;
+  }
+  return &entry_it->second;
+}
+
+tl::expected<void, std::string> Write_journal::record(const Journal_entry& entry) {
+  const auto line = format_entry(entry);
+  if (::write(_fd.get(), line.data(), line.size()) != static_cast<ssize_t>(line.size()) ||
+      ::fdatasync(_fd.get()) != 0) {
+    return tl::make_unexpected(fmt::format("Couldn't record {} in the write journal: {}",
+                                           entry.file_name, std::strerror(errno)));
+  }
+  _entries.insert_or_assign(entry.file_name, entry);
+  return {};
+}
+
+tl::expected<void, std::string> Write_journal::remove() {
+  _fd.reset();
+  std::error_code ec;
+  if (fs::remove(_path, ec); ec) {
+    return tl::make_unexpected(
+        fmt::format("Couldn't remove the write journal {}: {}", _path, ec.message()));
+  }
+  return {};
+}
+
+}  // namespace cyrus
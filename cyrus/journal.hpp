@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cyrus/cli.hpp>
+#include <cyrus/unique_fd.hpp>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <tl/expected.hpp>
+
+namespace cyrus {
+
+struct Journal_entry {
+  std::string file_name{};  // written file, relative to the mount point
+  std::uintmax_t size{0};
+  std::uint32_t checksum{0};     // CRC32C of the written words
+  std::uint32_t fingerprint{0};  // identifies the input file and conversion parameters
+};
+
+// identifies an input audio file's contents and the parameters it's converted with
+[[nodiscard]] std::uint32_t conversion_fingerprint(
+    const Parsed_arguments&, const std::filesystem::path& audio_file);
+
+// Record of the files completed by a run, kept in the destination's mount point,
+// so an interrupted run can be resumed. Every entry is synced to the device as
+// it's recorded.
+class Write_journal {
+ private:
+  std::filesystem::path _path{};
+  Unique_fd _fd{};
+  std::map<std::string, Journal_entry> _entries{};
+
+  Write_journal() = default;
+
+ public:
+  // reads the entries of the journal in mount_point when resuming. Nothing is
+  // written to the device until the journal is opened for recording.
+  [[nodiscard]] static Write_journal read(const std::filesystem::path& mount_point,
+                                          bool resume);
+
+  // opens the journal to record entries, discarding any prior ones unless resuming
+  [[nodiscard]] tl::expected<void, std::string> open_for_recording(bool resume);
+
+  // the entry of a file completed with the same fingerprint, whose written size
+  // is still as recorded
+  [[nodiscard]] const Journal_entry* completed(const std::filesystem::path& mount_point,
+                                               const std::string& file_name,
+                                               std::uint32_t fingerprint) const;
+
+  [[nodiscard]] tl::expected<void, std::string> record(const Journal_entry&);
+
+  // removes the journal once there's nothing left to resume
+  [[nodiscard]] tl::expected<void, std::string> remove();
+};
+
+}  // namespace cyrus
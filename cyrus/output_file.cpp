@@ -0,0 +1,265 @@
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>  // rename
+#include <cstring>
+#include <cyrus/output_file.hpp>
+#include <cyrus/unique_fd.hpp>
+#include <filesystem>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace cyrus {
+
+namespace {
+
+constexpr const char* const partial_extension{".part"};
+// bytes written before a file's placement on its device is looked up, as file
+// systems only place the clusters of written data
+constexpr std::size_t placement_probe_size{4096};
+
+[[nodiscard]] tl::expected<void, std::string> write_all(
+    const int fd, const std::span<const std::byte> data, const fs::path& path) {
+  std::size_t written{0};
+  while (written < data.size()) {
+    const auto num_written = ::write(fd, data.data() + written, data.size() - written);
+    if (num_written < 0 && errno == EINTR) {
+      continue;
+    } else if (num_written < 0) {
+      return tl::make_unexpected(
+          fmt::format("Couldn't write {}: {}", path, std::strerror(errno)));
+    }
+    written += static_cast<std::size_t>(num_written);
+  }
+  return {};
+}
+
+// offset of a file's first byte on its file system's device, if reported
+[[nodiscard]] std::optional<std::uint64_t> physical_offset(const int fd) noexcept {
+  // room for the request and the single extent returned after it
+  alignas(fiemap) std::array<std::byte, sizeof(fiemap) + sizeof(fiemap_extent)> request{};
+  auto* const map = new (request.data()) fiemap{};
+  map->fm_length = FIEMAP_MAX_OFFSET;
+  map->fm_extent_count = 1;
+  if (::ioctl(fd, FS_IOC_FIEMAP, map) != 0 || map->fm_mapped_extents == 0 ||
+      map->fm_extents[0].fe_logical != 0) {
+    return std::nullopt;
+  }
+  return map->fm_extents[0].fe_physical;
+}
+
+// File offset of the first write unit boundary. Files whose placement isn't
+// reported are aligned as if they started on a boundary.
+[[nodiscard]] std::uint64_t first_unit_boundary(const int fd,
+                                                const Write_layout& layout) noexcept {
+  const auto placement = physical_offset(fd);
+  if (!placement) {
+    return layout.unit_size;
+  }
+  const auto misalignment = (layout.partition_start + *placement) % layout.unit_size;
+  return layout.unit_size - misalignment;
+}
+
+// starts writing back a completed unit, without waiting for the device
+void write_back_unit(const int fd, const std::uint64_t begin, const std::uint64_t end) {
+  ::sync_file_range(fd, static_cast<off_t>(begin), static_cast<off_t>(end - begin),
+                    SYNC_FILE_RANGE_WRITE);
+}
+
+// writes pieces sequentially, in chunks that end on the layout's unit boundaries
+[[nodiscard]] tl::expected<void, std::string> write_units(
+    const int fd, const std::span<const std::span<const std::byte>> pieces,
+    const Write_layout& layout, const fs::path& path) {
+  std::uint64_t offset{0};
+  std::uint64_t unit_begin{0};
+  std::optional<std::uint64_t> unit_end{};
+  for (auto remaining : pieces) {
+    while (!remaining.empty()) {
+      if (!unit_end && offset > 0) {
+        unit_end = first_unit_boundary(fd, layout);
+        while (*unit_end < offset) {
+          *unit_end += layout.unit_size;
+        }
+      }
+      const auto chunk_end = unit_end.value_or(placement_probe_size);
+      const auto chunk =
+          std::min(remaining.size(), static_cast<std::size_t>(chunk_end - offset));
+      if (const auto written = write_all(fd, remaining.first(chunk), path); !written) {
+        return written;
+      }
+      offset += chunk;
+      remaining = remaining.subspan(chunk);
+
+      if (unit_end && offset == *unit_end) {
+        write_back_unit(fd, unit_begin, offset);
+        unit_begin = offset;
+        *unit_end += layout.unit_size;
+      }
+    }
+  }
+  return {};
+}
+
+// syncs a written partial file, then renames it over path
+[[nodiscard]] tl::expected<void, std::string> rename_partial(Unique_fd fd,
+                                                            const fs::path& path) {
+  const auto partial = partial_path(path);
+  if (::fdatasync(fd.get()) != 0) {
+    return tl::make_unexpected(
+        fmt::format("Couldn't sync {}: {}", partial, std::strerror(errno)));
+  }
+  fd.reset();
+  if (std::rename(partial.c_str(), path.c_str()) != 0) {
+    return tl::make_unexpected(fmt::format("Couldn't rename {} to {}: {}", partial, path,
+                                           std::strerror(errno)));
+  }
+  return {};
+}
+
+}  // namespace
+
+fs::path partial_path(const fs::path& path) {
+  auto partial = path;
+  partial += partial_extension;
+  return partial;
+}
+
+tl::expected<void, std::string> write_file_atomically(
+    const fs::path& path, const std::span<const std::byte> data,
+    const Write_layout& layout) {
+  return write_file_atomically(path, std::span{&data, 1}, layout);
+}
+
+tl::expected<void, std::string> write_file_atomically(
+    const fs::path& path, const std::span<const std::span<const std::byte>> pieces,
+    const Write_layout& layout) {
+  const auto partial = partial_path(path);
+  Unique_fd fd(::open(partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+  if (!fd) {
+    return tl::make_unexpected(fmt::format("Couldn't open the destination file: {}: {}",
+                                           partial, std::strerror(errno)));
+  }
+
+  // reserve the file's clusters up front, so they can be allocated contiguously.
+  // Filesystems that can't are written regardless.
+  std::size_t size{0};
+  for (const auto piece : pieces) {
+    size += piece.size();
+  }
+  if (size > 0) {
+    ::fallocate(fd.get(), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+  }
+
+  auto written = write_units(fd.get(), pieces, layout, partial).and_then([&] {
+    return rename_partial(std::move(fd), path);
+  });
+  if (!written) {
+    std::error_code ec;
+    fs::remove(partial, ec);
+  }
+  return written;
+}
+
+
+tl::expected<Mapped_output_file, std::string> Mapped_output_file::create(
+    const fs::path& path, const std::size_t size, const Write_layout& layout) {
+  Mapped_output_file file;
+  file._path = path;
+  file._layout = layout;
+  const auto partial = partial_path(path);
+  file._fd.reset(::open(partial.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644));
+  if (!file._fd) {
+    return tl::make_unexpected(fmt::format("Couldn't open the destination file: {}: {}",
+                                           partial, std::strerror(errno)));
+  }
+
+  if (::ftruncate(file._fd.get(), static_cast<off_t>(size)) != 0) {
+    return tl::make_unexpected(fmt::format("Couldn't size {} to {} bytes: {}", partial,
+                                           size, std::strerror(errno)));
+  }
+
+  // mapping no bytes is invalid, but there's nothing to write anyway
+  if (size > 0) {
+    void* const mapped =
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file._fd.get(), 0);
+    if (mapped == MAP_FAILED) {
+      return tl::make_unexpected(
+          fmt::format("Couldn't map {}: {}", partial, std::strerror(errno)));
+    }
+    file._data = static_cast<std::byte*>(mapped);
+    file._size = size;
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+  }
+  return file;
+}
+
+Mapped_output_file::Mapped_output_file(Mapped_output_file&& other) noexcept
+    : _path{std::move(other._path)},
+      _fd{std::move(other._fd)},
+      _data{std::exchange(other._data, nullptr)},
+      _size{std::exchange(other._size, 0)},
+      _layout{other._layout} {}
+
+Mapped_output_file& Mapped_output_file::operator=(Mapped_output_file&& other) noexcept {
+  if (this != &other) {
+    discard();
+    _path = std::move(other._path);
+    _fd = std::move(other._fd);
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0);
+    _layout = other._layout;
+  }
+  return *this;
+}
+
+Mapped_output_file::~Mapped_output_file() { discard(); }
+
+void Mapped_output_file::discard() noexcept {
+  unmap();
+  if (_fd) {
+    _fd.reset();
+    std::error_code ec;
+    fs::remove(partial_path(_path), ec);
+  }
+}
+
+void Mapped_output_file::unmap() noexcept {
+  if (_data != nullptr) {
+    ::munmap(_data, _size);
+    _data = nullptr;
+    _size = 0;
+  }
+}
+
+tl::expected<void, std::string> Mapped_output_file::commit() {
+  // hand the device every unit in order, before waiting on them all
+  if (_data != nullptr) {
+    std::uint64_t unit_begin{0};
+    for (auto unit_end = first_unit_boundary(_fd.get(), _layout); unit_begin < _size;
+         unit_end += _layout.unit_size) {
+      const auto end = std::min<std::uint64_t>(unit_end, _size);
+      write_back_unit(_fd.get(), unit_begin, end);
+      unit_begin = end;
+    }
+  }
+  if (_data != nullptr && ::msync(_data, _size, MS_SYNC) != 0) {
+    return tl::make_unexpected(fmt::format("Couldn't write back {}: {}",
+                                           partial_path(_path), std::strerror(errno)));
+  }
+  unmap();
+  return rename_partial(std::move(_fd), _path);
+}
+
+}  // namespace cyrus
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cyrus/unique_fd.hpp>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <tl/expected.hpp>
+
+namespace cyrus {
+
+// flash erase blocks and allocation units are rarely reported, so absent a reported
+// optimal I/O size, writes use the 4 MiB allocation unit common to SD cards
+constexpr const std::size_t default_write_unit_size{std::size_t{4} << 20};
+
+// Flash erases and programs whole units, so written files are handed to the device
+// in units of unit_size bytes, aligned to unit_size from the start of the drive. As
+// each unit is completed it's written back, rather than left to the page cache.
+struct Write_layout {
+  std::size_t unit_size{default_write_unit_size};
+  std::uint64_t partition_start{0};  // offset of the file system from its drive's start
+};
+
+// path of the temporary sibling that a file is written to before taking its name
+[[nodiscard]] std::filesystem::path partial_path(const std::filesystem::path&);
+
+// Writes data to a temporary sibling of path, which is synced and then renamed
+// over path. An interrupted write never leaves a partial file under path.
+[[nodiscard]] tl::expected<void, std::string> write_file_atomically(
+    const std::filesystem::path& path, std::span<const std::byte> data,
+    const Write_layout& layout = {});
+
+// writes the concatenation of pieces, reserving the file's full size beforehand
+[[nodiscard]] tl::expected<void, std::string> write_file_atomically(
+    const std::filesystem::path& path, std::span<const std::span<const std::byte>> pieces,
+    const Write_layout& layout = {});
+
+// A destination file, sized and mapped into memory so that its words can be
+// encoded straight into its pages. Like write_file_atomically(), it's written as a
+// temporary sibling that only takes the destination's name once committed.
+class Mapped_output_file {
+ private:
+  std::filesystem::path _path{};
+  Unique_fd _fd{};
+  std::byte* _data{nullptr};
+  std::size_t _size{0};
+  Write_layout _layout{};
+
+  Mapped_output_file() = default;
+  void unmap() noexcept;
+  // unmaps and removes an uncommitted file
+  void discard() noexcept;
+
+ public:
+  [[nodiscard]] static tl::expected<Mapped_output_file, std::string> create(
+      const std::filesystem::path& path, std::size_t size,
+      const Write_layout& layout = {});
+
+  Mapped_output_file(const Mapped_output_file&) = delete;
+  Mapped_output_file& operator=(const Mapped_output_file&) = delete;
+  Mapped_output_file(Mapped_output_file&&) noexcept;
+  Mapped_output_file& operator=(Mapped_output_file&&) noexcept;
+  ~Mapped_output_file();
+
+  [[nodiscard]] std::span<std::byte> data() const noexcept { return {_data, _size}; }
+
+  // writes back the mapped pages and renames the file over its destination
+  [[nodiscard]] tl::expected<void, std::string> commit();
+};
+
+}  // namespace cyrus
@@ -2,13 +2,24 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
 #include <bit>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cyrus/cpu_kernels.hpp>
 #include <limits>
 #include <numeric>
 #include <source_location>
+#include <span>
 #include <stdexcept>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace cyrus {
 
 using Ratio_t = double;
@@ -28,8 +39,8 @@ template <Sample SampleTo, ConvertibleSample<SampleTo> SampleFrom>
 requires std::convertible_to<SampleFrom, Ratio_t>
 class Sample_remapper {
  private:
-  Ratio_t scale{1.0};
-  Ratio_t shift{0};
+  Ratio_t _scale{1.0};
+  Ratio_t _shift{0};
 
  public:
   struct Remap_values {
@@ -56,28 +67,178 @@ class Sample_remapper {
           vals.from_min, vals.from_max, loc.file_name(), loc.line(), loc.column()));
     }
 
-    this->scale = (to_max - to_min) / from_range;
-    this->shift =
+    this->_scale = (to_max - to_min) / from_range;
+    this->_shift =
         std::abs(std::midpoint(to_min, to_max) - std::midpoint(from_min, from_max));
   }
 
   inline SampleTo operator()(const SampleFrom from) const noexcept {
-    return static_cast<SampleTo>(this->scale * from + this->shift);
+    return static_cast<SampleTo>(this->_scale * from + this->_shift);
   }
+
+  [[nodiscard]] Ratio_t scale() const noexcept { return _scale; }
+  [[nodiscard]] Ratio_t shift() const noexcept { return _shift; }
 };
 
 // return value will be interpreted completely differently on the running
 // architecture
 template <Sample S>
-inline S flip_sample_endianness(S sample) noexcept {
-  auto *upper = static_cast<std::byte *>(&sample);
-  auto *lower = upper + sizeof(S) - 1;
-  while (upper != lower) {
-    std::swap(upper, lower);
-    ++upper;
-    --lower;
+[[nodiscard]] inline S flip_sample_endianness(const S sample) noexcept {
+  auto bytes = std::bit_cast<std::array<std::byte, sizeof(S)>>(sample);
+  std::reverse(bytes.begin(), bytes.end());
+  return std::bit_cast<S>(bytes);
+}
+
+namespace detail {
+
+#if defined(__SSE2__)
+// reverses the bytes of every sizeof(S) byte word in a 16 byte vector
+template <Sample S>
+[[nodiscard]] inline __m128i flip_vector_endianness(__m128i v) noexcept {
+  if constexpr (sizeof(S) == 4) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+  } else if constexpr (sizeof(S) == 8) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+  }
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+
+}  // namespace detail
+
+// reverses the byte order of every sample in place, 16 bytes at a time where
+// the target supports it, falling back to flip_sample_endianness for the rest
+template <Sample S>
+inline void flip_endianness(const std::span<S> samples) noexcept {
+  std::size_t i = 0;
+  if constexpr (sizeof(S) == 1) {
+    return;
+  }
+#if defined(__SSE2__)
+  constexpr auto per_vector = sizeof(__m128i) / sizeof(S);
+  for (; i + per_vector <= samples.size(); i += per_vector) {
+    auto* const vec = std::bit_cast<__m128i*>(samples.data() + i);
+    _mm_storeu_si128(vec, detail::flip_vector_endianness<S>(_mm_loadu_si128(vec)));
+  }
+#endif
+  for (; i < samples.size(); ++i) {
+    samples[i] = flip_sample_endianness(samples[i]);
+  }
+}
+
+struct Word_format {
+  int bits{0};  // when non-zero, samples are bit-packed at this width
+  std::endian byte_order{std::endian::native};
+};
+
+// number of bytes occupied by num_samples encoded samples
+[[nodiscard]] constexpr std::size_t encoded_size(const std::size_t num_samples,
+                                                 const std::size_t word_size,
+                                                 const int bits) noexcept {
+  if (bits > 0) {
+    return (num_samples * static_cast<std::size_t>(bits) + 7) / 8;
+  }
+  return num_samples * word_size;
+}
+
+// Packs the low `bits` bits of every sample into a dense bit stream, with words
+// flushed 32 bits at a time. Little byte order fills each byte from its least
+// significant bit, while big byte order fills from its most significant bit, so
+// that a packed sample reads as a big-endian bit field. out must hold
+// encoded_size(samples.size(), sizeof(U), bits) bytes.
+template <std::unsigned_integral U>
+void pack_samples(const std::span<const U> samples, const int bits,
+                  const std::endian byte_order, const std::span<std::byte> out) noexcept {
+  const auto width = static_cast<unsigned>(bits);
+  const auto mask = (std::uint64_t{1} << width) - 1;
+  std::uint64_t acc{0};
+  unsigned acc_bits{0};
+  auto* dst = out.data();
+
+  if (byte_order == std::endian::little) {
+    for (const auto sample : samples) {
+      acc |= (sample & mask) << acc_bits;
+      acc_bits += width;
+      if (acc_bits >= 32) {
+        for (unsigned b = 0; b < 4; ++b) {
+          *dst++ = static_cast<std::byte>(acc >> (8 * b));
+        }
+        acc >>= 32;
+        acc_bits -= 32;
+      }
+    }
+    for (; acc_bits > 0; acc_bits -= std::min(acc_bits, 8u)) {
+      *dst++ = static_cast<std::byte>(acc);
+      acc >>= 8;
+    }
+  } else {
+    // only the low acc_bits bits of acc are pending
+    for (const auto sample : samples) {
+      acc = (acc << width) | (sample & mask);
+      acc_bits += width;
+      if (acc_bits >= 32) {
+        const auto word = acc >> (acc_bits - 32);
+        for (unsigned b = 0; b < 4; ++b) {
+          *dst++ = static_cast<std::byte>(word >> (24 - 8 * b));
+        }
+        acc_bits -= 32;
+      }
+    }
+    for (; acc_bits >= 8; acc_bits -= 8) {
+      *dst++ = static_cast<std::byte>(acc >> (acc_bits - 8));
+    }
+    if (acc_bits > 0) {
+      *dst = static_cast<std::byte>(acc << (8 - acc_bits));
+    }
+  }
+}
+
+namespace detail {
+
+// samples encoded per block, sized to keep a block's words within L1. Being a
+// multiple of 8, bit-packed blocks always end on a byte boundary.
+constexpr std::size_t encode_block_size{2048};
+
+}  // namespace detail
+
+// Remaps blocks of samples small enough to stay cache resident and encodes them
+// straight into out, so that flipping byte order or bit-packing costs no extra
+// pass. out must hold encoded_size(samples.size(), sizeof(To), format.bits) bytes.
+// When packing, only the final encoded run may end part way through a byte.
+template <std::unsigned_integral To, Sample From>
+void encode_samples(const std::span<const From> samples,
+                    const Sample_remapper<To, From>& remapper, const Word_format& format,
+                    const std::span<std::byte> out) {
+  std::array<To, detail::encode_block_size> block;
+  auto* dst = out.data();
+
+  for (std::size_t start = 0; start < samples.size(); start += block.size()) {
+    const auto count = std::min(block.size(), samples.size() - start);
+    const std::span words{block.data(), count};
+    if constexpr (std::same_as<From, float>) {
+      kernels::remap(samples.subspan(start, count), remapper.scale(), remapper.shift(),
+                     words);
+    } else {
+      for (std::size_t i = 0; i < count; ++i) {
+        block[i] = remapper(samples[start + i]);
+      }
+    }
+
+    const auto encoded = encoded_size(count, sizeof(To), format.bits);
+    if (format.bits > 0) {
+      pack_samples<To>(words, format.bits, format.byte_order, {dst, encoded});
+    } else {
+      if constexpr (sizeof(To) > 1) {
+        if (format.byte_order != std::endian::native) {
+          kernels::flip_endianness(words);
+        }
+      }
+      std::memcpy(dst, block.data(), encoded);
+    }
+    dst += encoded;
   }
-  return sample;
 }
 
 }  // namespace cyrus
\ No newline at end of file
@@ -1,14 +1,25 @@
 #pragma once
 
 #include <fmt/core.h>
+#include <samplerate.h>
 
 #include <algorithm>
+#include <array>
 #include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <cyrus/audio_signal.hpp>
+#include <cyrus/checksum.hpp>
 #include <cyrus/cli.hpp>
+#include <cyrus/cpu_kernels.hpp>
 #include <cyrus/sample_conversions.hpp>
 #include <cyrus/try.hpp>
 #include <filesystem>
+#include <span>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -49,20 +60,85 @@ class Min_max_enlarger : public Enlarger<From> {
  public:
   explicit Min_max_enlarger(const Parsed_arguments& args) : Enlarger<From>(args) {}
   std::pair<From, From> enlarge(const Audio_signal<From>& a) const noexcept override {
-    const auto [from_min, from_max] = std::ranges::minmax(a);
-    return {from_min, from_max};
+    if constexpr (std::same_as<From, float>) {
+      return kernels::min_max(std::span<const float>{a.begin(), a.end()});
+    } else {
+      const auto [from_min, from_max] = std::ranges::minmax(a);
+      return {from_min, from_max};
+    }
   }
 };
 
+// libsamplerate's sinc converters from fastest to best, with their signal-to-noise
+// ratios in dB
+constexpr std::array<std::pair<int, double>, 3> sinc_converters{
+    {{SRC_SINC_FASTEST, 97.0},
+     {SRC_SINC_MEDIUM_QUALITY, 121.0},
+     {SRC_SINC_BEST_QUALITY, 145.0}}};
+
 }  // namespace detail
 
-template <Sample From, Sample To>
-[[nodiscard]] tl::expected<std::vector<std::vector<std::byte>>, std::string>
-convert_audio(const Parsed_arguments& args,
-              const std::vector<std::pair<std::filesystem::path, Audio_signal<From>>>&
-                  loaded_audios) {
+// The libsamplerate converter to resample with. Automatic quality picks the fastest
+// converter whose noise floor lies below the quantization noise of the output
+// range, as any less noise can't be represented in the written words.
+[[nodiscard]] inline int resample_converter(const Parsed_arguments& args) {
+  switch (args.quality) {
+    case Resample_quality::fastest:
+      return SRC_SINC_FASTEST;
+    case Resample_quality::medium:
+      return SRC_SINC_MEDIUM_QUALITY;
+    case Resample_quality::best:
+      return SRC_SINC_BEST_QUALITY;
+    case Resample_quality::automatic:
+      break;
+  }
+
+  // signal-to-noise ratio of a full-scale sine quantized to the range's levels
+  const auto levels = static_cast<double>(args.range_max - args.range_min) + 1.0;
+  const auto quantization_snr = 20.0 * std::log10(levels) + 1.76;
+  for (const auto& [converter, snr] : detail::sinc_converters) {
+    if (snr >= quantization_snr) {
+      return converter;
+    }
+  }
+  return SRC_SINC_BEST_QUALITY;
+}
+
+// the finer of two converters, for a resampling shared by outputs that need either
+[[nodiscard]] constexpr int finer_converter(const int converter,
+                                            const int other) noexcept {
+  const auto rank = [](const int c) {
+    return std::ranges::find(detail::sinc_converters, c, &std::pair<int, double>::first) -
+           detail::sinc_converters.begin();
+  };
+  return rank(converter) >= rank(other) ? converter : other;
+}
+
+struct Converted_audio {
+  std::vector<std::byte> words{};
+  std::uint32_t checksum{0};  // CRC32C of words
+};
+
+// receives the encoded words of each converted audio file
+class Conversion_sink {
+ public:
+  // buffer of size bytes that the audio file's words are encoded into
+  virtual tl::expected<std::span<std::byte>, std::string> allocate(
+      const std::filesystem::path& audio_file, std::size_t size) = 0;
+  // called once the buffer from allocate() holds all of the audio file's words
+  virtual tl::expected<void, std::string> commit(const std::filesystem::path& audio_file,
+                                                 std::uint32_t checksum) = 0;
+  virtual ~Conversion_sink() noexcept = default;
+};
+
+// remaps a resampled audio signal to the output range, encoding its words into the sink
+template <Sample From, std::unsigned_integral To>
+[[nodiscard]] tl::expected<void, std::string> encode_words(
+    const Parsed_arguments& args, const std::filesystem::path& in_audio_path,
+    const Audio_signal<From>& resampled, Conversion_sink& sink) {
   detail::Remap<From, To> remap_values{.to_min = static_cast<To>(args.range_min),
                                        .to_max = static_cast<To>(args.range_max)};
+  const Word_format format{.bits = args.bits, .byte_order = args.endian};
   detail::Min_max_enlarger<From> min_max(args);
   detail::Echo_enlarger<From, To> echo(args, remap_values);
   detail::Enlarger<From>* enlarger{&echo};
@@ -70,27 +146,48 @@ convert_audio(const Parsed_arguments& args,
     enlarger = &min_max;
   }
 
-  std::vector<std::vector<std::byte>> converted;
-  converted.reserve(loaded_audios.size());
-  for (const auto& [in_audio_path, loaded_audio] : loaded_audios) {
-    const auto resampled =
-        TRY(loaded_audio.resampled(args.sample_rate).map_error([](const auto& err) {
-          return fmt::format("Failed to resample: {}.", audio_error_message(err));
-        }));
-
-    fmt::print("\t✔ resampled {}", in_audio_path);
+  const auto [from_min, from_max] = enlarger->enlarge(resampled);
+  remap_values.from_min = from_min;
+  remap_values.from_max = from_max;
+  const auto words = TRY(sink.allocate(
+      in_audio_path, encoded_size(resampled.size(), sizeof(To), format.bits)));
+  resampled.template encode<To>(remap_values, format, words);
+  return sink.commit(in_audio_path, crc32c(words));
+}
 
-    const auto [from_min, from_max] = enlarger->enlarge(resampled);
-    remap_values.from_min = from_min;
-    remap_values.from_max = from_max;
-    const auto remapped = resampled.template remapped<To>(remap_values);
-    fmt::print("\r\t✔ resampled  ✔ remapped {}\n", in_audio_path);
+// size in bytes of the words samples are remapped to before being encoded.
+// Bit-packed samples are remapped to the widest packable word before packing.
+[[nodiscard]] inline int remap_word_size(const Parsed_arguments& args) noexcept {
+  return args.bits > 0 ? static_cast<int>(sizeof(std::uint32_t)) : args.word_size;
+}
 
-    auto* start = std::bit_cast<std::byte*>(remapped.data());
-    converted.emplace_back(start, start + remapped.size() * sizeof(To));
+// returns fn(std::type_identity<To>{}) for the unsigned word type To that samples
+// are remapped to
+template <typename Fn>
+[[nodiscard]] tl::expected<void, std::string> with_remap_word(const Parsed_arguments& args,
+                                                              Fn&& fn) {
+  switch (remap_word_size(args)) {
+    case 1:
+      return fn(std::type_identity<std::uint8_t>{});
+    case 2:
+      return fn(std::type_identity<std::uint16_t>{});
+    case 4:
+      return fn(std::type_identity<std::uint32_t>{});
+    case 8:
+      return fn(std::type_identity<std::uint64_t>{});
+    default:
+      return tl::make_unexpected(fmt::format(
+          "Cannot convert audio samples to a word size of {} bytes", args.word_size));
   }
+}
 
-  return converted;
+template <Sample From>
+[[nodiscard]] tl::expected<void, std::string> encode_audio(
+    const Parsed_arguments& args, const std::filesystem::path& in_audio_path,
+    const Audio_signal<From>& resampled, Conversion_sink& sink) {
+  return with_remap_word(args, [&]<std::unsigned_integral To>(std::type_identity<To>) {
+    return encode_words<From, To>(args, in_audio_path, resampled, sink);
+  });
 }
 
 }  // namespace cyrus
@@ -0,0 +1,231 @@
+#include <fmt/core.h>
+#include <fmt/ostream.h>
+#include <samplerate.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <concepts>
+#include <cstdio>
+#include <cstring>
+#include <cyrus/audio_signal.hpp>
+#include <cyrus/cli.hpp>
+#include <cyrus/cpu_kernels.hpp>
+#include <cyrus/sample_conversions.hpp>
+#include <cyrus/signal_conversions.hpp>
+#include <cyrus/stream_audio.hpp>
+#include <cyrus/stream_source.hpp>
+#include <cyrus/try.hpp>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <sndfile.hh>
+#include <span>
+#include <tl/expected.hpp>
+#include <type_traits>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace cyrus {
+
+namespace {
+
+// frames decoded, resampled and encoded at a time
+constexpr sf_count_t stream_block_frames{4096};
+constexpr std::size_t stdout_buffer_size{std::size_t{1} << 16};
+
+struct Src_state_deleter {
+  void operator()(SRC_STATE* state) const noexcept { src_delete(state); }
+};
+using Src_state_ptr = std::unique_ptr<SRC_STATE, Src_state_deleter>;
+
+[[nodiscard]] tl::expected<void, std::string> write_to_stdout(
+    const std::span<const std::byte> bytes) {
+  if (std::fwrite(bytes.data(), 1, bytes.size(), stdout) != bytes.size()) {
+    return tl::make_unexpected(
+        fmt::format("Failed writing to standard output: {}", std::strerror(errno)));
+  }
+  return {};
+}
+
+// bytes per sample of uncompressed subtypes, or 0 for any other
+[[nodiscard]] sf_count_t uncompressed_sample_size(const int format) noexcept {
+  switch (format & SF_FORMAT_SUBMASK) {
+    case SF_FORMAT_PCM_S8:
+    case SF_FORMAT_PCM_U8:
+      return 1;
+    case SF_FORMAT_PCM_16:
+      return 2;
+    case SF_FORMAT_PCM_24:
+      return 3;
+    case SF_FORMAT_PCM_32:
+    case SF_FORMAT_FLOAT:
+      return 4;
+    case SF_FORMAT_DOUBLE:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+// Whether a header's frame count comes from a placeholder rather than the stream's
+// length. Writers that can't seek back to a header, such as ffmpeg writing WAV or
+// AIFF to a pipe, leave its 32-bit data size at its maximum.
+[[nodiscard]] bool has_placeholder_length(const SndfileHandle& sndfile_handle) {
+  constexpr sf_count_t max_data_size{0xFFFF'FFFF};
+  constexpr sf_count_t data_header_size{8};  // an AIFF sound data chunk's offset fields
+  const auto frame_size =
+      uncompressed_sample_size(sndfile_handle.format()) * sndfile_handle.channels();
+  return sndfile_handle.frames() == std::numeric_limits<sf_count_t>::max() ||
+         (frame_size > 0 && sndfile_handle.frames() * frame_size + frame_size +
+                                    data_header_size >
+                                max_data_size);
+}
+
+template <std::unsigned_integral To>
+[[nodiscard]] tl::expected<void, std::string> stream_audio_file(
+    const Parsed_arguments& args, const fs::path& audio_path,
+    SndfileHandle sndfile_handle) {
+  if (const auto errc = static_cast<Audio_error_code>(sndfile_handle.error());
+      errc != Audio_error_code::no_error) {
+    return tl::make_unexpected(fmt::format("An error occurred while opening {}: {}",
+                                           audio_path, audio_error_message(errc)));
+  } else if (sndfile_handle.channels() < 1 || sndfile_handle.channels() > 2) {
+    return tl::make_unexpected(fmt::format(
+        "{}: {}", audio_path,
+        audio_error_message(Audio_error_code::unsupported_number_of_channels)));
+  }
+
+  const auto channels = sndfile_handle.channels();
+  const auto resample_ratio =
+      static_cast<double>(args.sample_rate) / sndfile_handle.samplerate();
+  const auto converter = resample_converter(args);
+  Src_state_ptr resampler;
+  if (sndfile_handle.samplerate() != args.sample_rate) {
+    int src_errc{0};
+    resampler.reset(src_new(converter, 1, &src_errc));
+    if (!resampler) {
+      return tl::make_unexpected(
+          fmt::format("Failed to resample {}: {}", audio_path, src_strerror(src_errc)));
+    }
+  }
+
+  const Sample_remapper<To, float> remapper(
+      {.to_min = static_cast<To>(args.range_min),
+       .to_max = static_cast<To>(args.range_max)});
+  const Word_format format{.bits = args.bits, .byte_order = args.endian};
+  const auto resampled_capacity = resampled_size(
+      static_cast<std::size_t>(stream_block_frames), sndfile_handle.samplerate(),
+      args.sample_rate);
+
+  std::vector<float> interleaved(
+      static_cast<std::size_t>(stream_block_frames * channels));
+  std::vector<float> mono(static_cast<std::size_t>(stream_block_frames));
+  std::vector<float> pending;  // mono samples awaiting encoding
+  std::vector<std::byte> encoded;
+
+  // encodes pending samples in multiples of 8, so packed runs end on a byte boundary
+  const auto encode_pending = [&](const bool final) {
+    const auto count = final ? pending.size() : pending.size() / 8 * 8;
+    encoded.resize(encoded_size(count, sizeof(To), format.bits));
+    encode_samples<To, float>({pending.data(), count}, remapper, format, encoded);
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(count));
+    return write_to_stdout(encoded);
+  };
+
+  bool end_of_input{false};
+  sf_count_t decoded_frames{0};
+  while (!end_of_input) {
+    const auto num_frames = sndfile_handle.readf(interleaved.data(), stream_block_frames);
+    end_of_input = num_frames < stream_block_frames;
+    decoded_frames += num_frames;
+
+    // convert any stereo data to mono by averaging channels
+    const auto frames = static_cast<std::size_t>(num_frames);
+    if (channels == 1) {
+      std::copy_n(interleaved.cbegin(), frames, mono.begin());
+    } else {
+      kernels::downmix_stereo({interleaved.data(), 2 * frames}, {mono.data(), frames});
+    }
+
+    if (!resampler) {
+      pending.insert(pending.end(), mono.cbegin(), mono.cbegin() + num_frames);
+    } else {
+      SRC_DATA conversion_data{};
+      conversion_data.data_in = mono.data();
+      conversion_data.input_frames = static_cast<long>(num_frames);
+      conversion_data.end_of_input = end_of_input ? 1 : 0;
+      conversion_data.src_ratio = resample_ratio;
+
+      // drain the converter, including its delayed tail after the final block
+      do {
+        const auto offset = pending.size();
+        pending.resize(offset + resampled_capacity);
+        conversion_data.data_out = pending.data() + offset;
+        conversion_data.output_frames = static_cast<long>(resampled_capacity);
+        if (const auto src_errc = src_process(resampler.get(), &conversion_data);
+            src_errc != 0) {
+          return tl::make_unexpected(fmt::format("Failed to resample {}: {}", audio_path,
+                                                 src_strerror(src_errc)));
+        }
+        pending.resize(offset +
+                       static_cast<std::size_t>(conversion_data.output_frames_gen));
+        conversion_data.data_in += conversion_data.input_frames_used;
+        conversion_data.input_frames -= conversion_data.input_frames_used;
+      } while (conversion_data.input_frames > 0 ||
+               (end_of_input && conversion_data.output_frames_gen > 0));
+    }
+
+    REQ(encode_pending(end_of_input))
+  }
+
+  // a stream that ends early would otherwise pass as a short, but complete, file
+  if (decoded_frames != sndfile_handle.frames() &&
+      !has_placeholder_length(sndfile_handle)) {
+    return tl::make_unexpected(
+        fmt::format("{} ended after {} of the {} frames its header declares",
+                    audio_path, decoded_frames, sndfile_handle.frames()));
+  }
+
+  if (resampler) {
+    fmt::print(stderr, "\t✔ streamed {} with {}\n", audio_path, src_get_name(converter));
+  } else {
+    fmt::print(stderr, "\t✔ streamed {}\n", audio_path);
+  }
+  return {};
+}
+
+template <std::unsigned_integral To>
+[[nodiscard]] tl::expected<void, std::string> stream_audio_files(
+    const Parsed_arguments& args) {
+  for (const auto& audio_path : args.audio_files) {
+    if (audio_path == stdio_path) {
+      Stream_source stdin_source(STDIN_FILENO);
+      REQ(stream_audio_file<To>(
+          args, "<stdin>", SndfileHandle(Stream_source::virtual_io(), &stdin_source)))
+    } else {
+      REQ(stream_audio_file<To>(args, audio_path, SndfileHandle(audio_path.c_str())))
+    }
+  }
+  return {};
+}
+
+}  // namespace
+
+tl::expected<void, std::string> stream_audio_to_stdout(const Parsed_arguments& args) {
+  fmt::print(stderr, "Streaming audio to standard output... \n");
+  std::setvbuf(stdout, nullptr, _IOFBF, stdout_buffer_size);
+
+  REQ(with_remap_word(args, [&]<std::unsigned_integral To>(std::type_identity<To>) {
+    return stream_audio_files<To>(args);
+  }))
+
+  if (std::fflush(stdout) != 0) {
+    return tl::make_unexpected(
+        fmt::format("Failed writing to standard output: {}", std::strerror(errno)));
+  }
+  return {};
+}
+
+}  // namespace cyrus
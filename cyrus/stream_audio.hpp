@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cyrus/cli.hpp>
+#include <string>
+#include <tl/expected.hpp>
+
+namespace cyrus {
+
+// converts the audio files block by block, writing encoded words to stdout as
+// they're produced
+tl::expected<void, std::string> stream_audio_to_stdout(const Parsed_arguments&);
+
+}  // namespace cyrus
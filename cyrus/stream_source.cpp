@@ -0,0 +1,113 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>  // SEEK_SET, SEEK_CUR
+#include <cstring>
+#include <cyrus/stream_source.hpp>
+#include <limits>
+
+namespace cyrus {
+
+namespace {
+
+Stream_source& source(void* user_data) {
+  return *static_cast<Stream_source*>(user_data);
+}
+
+}  // namespace
+
+Stream_source::Stream_source(const int fd) : _fd{fd} { _head.reserve(head_capacity); }
+
+SF_VIRTUAL_IO& Stream_source::virtual_io() noexcept {
+  static SF_VIRTUAL_IO vio{
+      // the stream's length is unknown until its end, so never limit libsndfile
+      .get_filelen = [](void*) { return std::numeric_limits<sf_count_t>::max(); },
+      .seek = [](const sf_count_t offset, const int whence,
+                 void* user_data) { return source(user_data).seek(offset, whence); },
+      .read = [](void* ptr, const sf_count_t count,
+                 void* user_data) { return source(user_data).read(ptr, count); },
+      .write = [](const void*, sf_count_t, void*) { return sf_count_t{0}; },
+      .tell = [](void* user_data) { return source(user_data).tell(); }};
+  return vio;
+}
+
+sf_count_t Stream_source::read_stream(std::byte* const dst, const sf_count_t count) {
+  sf_count_t total{0};
+  while (total < count) {
+    const auto num_read =
+        ::read(_fd, dst + total, static_cast<std::size_t>(count - total));
+    if (num_read < 0 && errno == EINTR) {
+      continue;
+    } else if (num_read <= 0) {
+      break;
+    }
+
+    const auto retained =
+        std::min(static_cast<std::size_t>(num_read), head_capacity - _head.size());
+    _head.insert(_head.end(), dst + total, dst + total + retained);
+    total += num_read;
+  }
+  _consumed += total;
+  return total;
+}
+
+sf_count_t Stream_source::read(void* const ptr, const sf_count_t count) {
+  auto* const dst = static_cast<std::byte*>(ptr);
+  const auto head_size = static_cast<sf_count_t>(_head.size());
+
+  // replay retained bytes that libsndfile seeked back to
+  sf_count_t replayed{0};
+  if (_position < _consumed) {
+    if (_position >= head_size) {
+      return 0;
+    }
+    replayed = std::min(count, head_size - _position);
+    std::memcpy(dst, _head.data() + _position, static_cast<std::size_t>(replayed));
+    _position += replayed;
+    if (_position < _consumed) {
+      return replayed;
+    }
+  }
+
+  const auto streamed = read_stream(dst + replayed, count - replayed);
+  _position += streamed;
+  return replayed + streamed;
+}
+
+sf_count_t Stream_source::seek(const sf_count_t offset, const int whence) {
+  sf_count_t target;
+  switch (whence) {
+    case SEEK_SET:
+      target = offset;
+      break;
+    case SEEK_CUR:
+      target = _position + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  // Only the retained head and the stream's current position can be reached.
+  // Skipping forward past the head would discard bytes that a header parser, having
+  // skipped over the audio data to probe for trailing chunks, then seeks back to.
+  // Failing such seeks stops the parser probing instead.
+  const auto head_end = static_cast<sf_count_t>(head_capacity);
+  if (target < 0 || (target > head_end && target != _consumed)) {
+    return -1;
+  }
+
+  // skipped bytes within the head are retained, so they can still be replayed
+  std::byte skipped[4096];
+  while (_consumed < target) {
+    const auto skip =
+        std::min(target - _consumed, static_cast<sf_count_t>(sizeof(skipped)));
+    if (read_stream(skipped, skip) < skip) {
+      break;
+    }
+  }
+  _position = std::min(target, _consumed);
+  return _position;
+}
+
+}  // namespace cyrus
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <sndfile.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace cyrus {
+
+// Presents a sequential stream, like a pipe, to libsndfile through its virtual I/O
+// interface. libsndfile treats virtual streams as seekable, so the stream's leading
+// bytes are retained, allowing it to seek back while parsing headers. Seeks beyond
+// the retained head fail, unless they're to the stream's current position. Memory
+// use is bounded by the retained head, regardless of the stream's length.
+class Stream_source {
+ private:
+  static constexpr std::size_t head_capacity{std::size_t{64} << 10};
+  int _fd;
+  std::vector<std::byte> _head{};
+  sf_count_t _position{0};  // position reported to libsndfile
+  sf_count_t _consumed{0};  // bytes read from the stream
+
+  sf_count_t read_stream(std::byte* dst, sf_count_t count);
+
+ public:
+  explicit Stream_source(int fd);
+  Stream_source(const Stream_source&) = delete;
+  Stream_source& operator=(const Stream_source&) = delete;
+
+  // callbacks for libsndfile, each expecting this as their user data
+  [[nodiscard]] static SF_VIRTUAL_IO& virtual_io() noexcept;
+
+  sf_count_t read(void* ptr, sf_count_t count);
+  sf_count_t seek(sf_count_t offset, int whence);
+  [[nodiscard]] sf_count_t tell() const noexcept { return _position; }
+};
+
+}  // namespace cyrus
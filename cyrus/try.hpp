@@ -7,7 +7,7 @@
     auto _tmp = (expression);                   \
     if (!_tmp) [[unlikely]]                     \
       return tl::make_unexpected(_tmp.error()); \
-    _tmp.value();                               \
+    std::move(_tmp).value();                    \
   })
 
 #define REQ(expression)                                       \
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <utility>
+
+namespace cyrus {
+
+// owns a POSIX file descriptor, closing it on destruction
+class Unique_fd {
+ private:
+  int _fd{-1};
+
+ public:
+  Unique_fd() = default;
+  explicit Unique_fd(const int fd) noexcept : _fd{fd} {}
+  Unique_fd(const Unique_fd&) = delete;
+  Unique_fd& operator=(const Unique_fd&) = delete;
+  Unique_fd(Unique_fd&& other) noexcept : _fd{std::exchange(other._fd, -1)} {}
+  Unique_fd& operator=(Unique_fd&& other) noexcept {
+    if (this != &other) {
+      reset(std::exchange(other._fd, -1));
+    }
+    return *this;
+  }
+  ~Unique_fd() { reset(); }
+
+  void reset(const int fd = -1) noexcept {
+    if (_fd >= 0) {
+      ::close(_fd);
+    }
+    _fd = fd;
+  }
+
+  [[nodiscard]] int get() const noexcept { return _fd; }
+
+  explicit operator bool() const noexcept { return _fd >= 0; }
+};
+
+}  // namespace cyrus
@@ -3,15 +3,34 @@
 #include <fmt/ranges.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cyrus/audio_signal.hpp>
+#include <cyrus/bundle.hpp>
+#include <cyrus/checksum.hpp>
+#include <cyrus/device_events.hpp>
 #include <cyrus/cli.hpp>
 #include <cyrus/device_probing.hpp>
+#include <cyrus/input_prefetch.hpp>
+#include <cyrus/journal.hpp>
+#include <cyrus/output_file.hpp>
 #include <cyrus/signal_conversions.hpp>
 #include <cyrus/try.hpp>
 #include <cyrus/write_audio.hpp>
+#include <exception>
 #include <filesystem>
-#include <fstream>
+#include <future>
+#include <list>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <ranges>
+#include <set>
+#include <span>
+#include <string>
+#include <thread>
 #include <tl/expected.hpp>
 #include <type_traits>
 #include <utility>
@@ -25,24 +44,59 @@ namespace cyrus {
 
 namespace {
 
+// an announced device's partition is mounted some time after it's announced
+constexpr std::chrono::seconds watched_mount_timeout{30};
+constexpr std::chrono::milliseconds watched_mount_poll_interval{250};
+
 using InSample = float;
 using Audio_signal_t = Audio_signal<InSample>;
 using Audio_file_paths = std::remove_cvref_t<decltype(Parsed_arguments::audio_files)>;
 
+[[nodiscard]] std::string output_file_name(const fs::path& audio_file_path) {
+  return fs::path(audio_file_path.filename()).replace_extension("raw").string();
+}
+
+[[nodiscard]] double mebibytes(const std::uintmax_t bytes) noexcept {
+  return static_cast<double>(bytes) / static_cast<double>(std::uintmax_t{1} << 20);
+}
+
 [[nodiscard]] tl::expected<std::vector<std::pair<fs::path, Audio_signal_t>>, std::string>
-load_audio_files(const Audio_file_paths& audio_file_paths) {
+load_audio_files(const Audio_file_paths& audio_file_paths,
+                 const std::vector<Frame_range>& frame_ranges) {
   std::vector<std::pair<fs::path, Audio_signal_t>> audio_signals;
   audio_signals.reserve(audio_file_paths.size());
 
-  for (const auto& audio_file_path : audio_file_paths) {
-    if (!fs::exists(audio_file_path)) {
-      return tl::make_unexpected(
-          fmt::format("The audio file {} doesn't exist.", audio_file_path));
+  // the next whole file is read while the current one decodes. Files converted in
+  // part are instead read through their own handles, around the decoded frames only.
+  Audio_file_paths whole_file_paths;
+  for (std::size_t file_idx = 0; file_idx < audio_file_paths.size(); ++file_idx) {
+    if (frame_ranges[file_idx].whole()) {
+      whole_file_paths.push_back(audio_file_paths[file_idx]);
     }
+  }
+  Input_prefetcher prefetcher(whole_file_paths);
 
+  for (std::size_t file_idx = 0; file_idx < audio_file_paths.size(); ++file_idx) {
+    const auto& audio_file_path = audio_file_paths[file_idx];
+    const auto& frame_range = frame_ranges[file_idx];
     Audio_signal_t audio_signal;
-    if (const auto errc = audio_signal.load(audio_file_path);
-        errc == Audio_error_code::hit_eof) {
+    auto errc = Audio_error_code::no_error;
+    if (frame_range.whole()) {
+      const auto prefetched = TRY(prefetcher.next());
+
+      // every decoding thread reads the prefetched file through its own source
+      std::vector<Memory_source> sources(detail::available_threads(),
+                                         Memory_source(prefetched.data()));
+      errc = audio_signal.load_parallel([&](const std::size_t idx) {
+        return SndfileHandle(Memory_source::virtual_io(), &sources[idx]);
+      });
+    } else {
+      errc = audio_signal.load_parallel(
+          [&](std::size_t) { return SndfileHandle(audio_file_path.c_str()); },
+          frame_range);
+    }
+
+    if (errc == Audio_error_code::hit_eof) {
       fmt::print("Warning: {}: {}\n", audio_error_message(errc), audio_file_path);
     } else if (errc != Audio_error_code::no_error) {
       return tl::make_unexpected(fmt::format("An error occurred while loading {}: {}\n",
@@ -56,6 +110,129 @@ load_audio_files(const Audio_file_paths& audio_file_paths) {
   return audio_signals;
 }
 
+// files written into a directory of the device, converted from the shared decoded audio
+struct Output {
+  fs::path directory{};  // relative to the mount point
+  Parsed_arguments args{};
+};
+
+// every profile's output, or a single output into the mount point when none are declared
+[[nodiscard]] std::vector<Output> device_outputs(const Parsed_arguments& args) {
+  if (args.profiles.empty()) {
+    return {{.directory = {}, .args = args}};
+  }
+  std::vector<Output> outputs;
+  for (const auto& profile : args.profiles) {
+    outputs.push_back(
+        {.directory = profile.directory, .args = profile_arguments(args, profile)});
+  }
+  return outputs;
+}
+
+struct Preflight {
+  std::uintmax_t decode_frames{0};
+  std::uintmax_t resample_frames{0};
+  std::uintmax_t write_size{0};
+  std::vector<Frame_range> frame_ranges{};  // decoded from each audio file
+};
+
+// The frames within an audio file's time range, with enough context either side to
+// resample them to every output's rate. It covers the filter of the finest converter
+// any output resamples with, as convert_audio_files resamples each rate with the
+// finest its outputs need. Downsampling widens the filter by the decimation factor.
+// The context spans whole periods in which input and output samples coincide, so
+// the first resampled sample falls on the range's start.
+[[nodiscard]] tl::expected<Frame_range, std::string> audio_frame_range(
+    const fs::path& audio_file_path, const Audio_header& header,
+    const Time_range& time_range, const std::vector<Output>& outputs) {
+  const auto to_frames = [&](const double seconds) {
+    return static_cast<sf_count_t>(std::llround(seconds * header.sample_rate));
+  };
+  Frame_range frame_range{.start = to_frames(time_range.start)};
+  if (frame_range.start > 0 && frame_range.start >= header.frames) {
+    return tl::make_unexpected(fmt::format(
+        "The audio file {} ends at {:.3f} seconds, before the start of its section at "
+        "{} seconds.",
+        audio_file_path,
+        static_cast<double>(header.frames) / static_cast<double>(header.sample_rate),
+        time_range.start));
+  }
+  if (time_range.duration) {
+    frame_range.frames = std::max(sf_count_t{1}, to_frames(*time_range.duration));
+  }
+
+  auto decimation = 0.0;
+  sf_count_t period{1};
+  int converter{SRC_SINC_FASTEST};
+  for (const auto& output : outputs) {
+    if (const auto sample_rate = output.args.sample_rate;
+        sample_rate != header.sample_rate) {
+      decimation = std::max(
+          {decimation, 1.0, static_cast<double>(header.sample_rate) / sample_rate});
+      period = std::lcm(period,
+                        header.sample_rate / std::gcd(header.sample_rate, sample_rate));
+      converter = finer_converter(converter, resample_converter(output.args));
+    }
+  }
+  const auto filter_margin = detail::resample_filter_margin(converter);
+  const auto margin = static_cast<sf_count_t>(
+      std::ceil(static_cast<double>(filter_margin) * decimation));
+  frame_range.context = (margin + period - 1) / period * period;
+  return frame_range;
+}
+
+// validates every audio file's header and predicts the size of its outputs, without
+// decoding any samples
+[[nodiscard]] tl::expected<Preflight, std::string> preflight_audio_files(
+    const Parsed_arguments& args, const Audio_file_paths& audio_file_paths,
+    const std::vector<Output>& outputs) {
+  Preflight preflight;
+  std::vector<std::vector<Bundle_clip>> bundle_clips(outputs.size());
+  for (const auto& audio_file_path : audio_file_paths) {
+    if (!fs::exists(audio_file_path)) {
+      return tl::make_unexpected(
+          fmt::format("The audio file {} doesn't exist.", audio_file_path));
+    }
+
+    const auto header =
+        TRY(read_audio_header(audio_file_path).map_error([&](const auto& errc) {
+          return fmt::format("An error occurred while opening {}: {}\n", audio_file_path,
+                             audio_error_message(errc));
+        }));
+
+    // every file's section is decoded once, and resampled once per distinct rate
+    const auto frame_range = TRY(audio_frame_range(
+        audio_file_path, header, audio_time_range(args, audio_file_path), outputs));
+    const auto [decoded_first, decoded_last] = frame_range.decoded(header.frames);
+    const auto [clip_first, clip_last] = frame_range.clip(header.frames);
+    const auto decoded_frames = static_cast<std::size_t>(decoded_last - decoded_first);
+    const auto frames = static_cast<std::size_t>(clip_last - clip_first);
+    preflight.decode_frames += decoded_frames;
+    preflight.frame_ranges.push_back(frame_range);
+    std::vector<int> resample_rates;
+    for (std::size_t output_idx = 0; output_idx < outputs.size(); ++output_idx) {
+      const auto& out_args = outputs[output_idx].args;
+      if (header.sample_rate != out_args.sample_rate &&
+          rgs::find(resample_rates, out_args.sample_rate) == resample_rates.end()) {
+        resample_rates.push_back(out_args.sample_rate);
+        preflight.resample_frames += decoded_frames;
+      }
+      const auto out_frames =
+          resampled_size(frames, header.sample_rate, out_args.sample_rate);
+      const auto out_size = encoded_size(
+          out_frames, static_cast<std::size_t>(out_args.word_size), out_args.bits);
+      preflight.write_size += out_args.bundle ? 0 : out_size;
+      bundle_clips[output_idx].push_back({.length = out_size});
+    }
+  }
+  for (std::size_t output_idx = 0; output_idx < outputs.size(); ++output_idx) {
+    if (outputs[output_idx].args.bundle) {
+      preflight.write_size += layout_bundle(bundle_clips[output_idx]);
+    }
+  }
+  return preflight;
+}
+
 [[nodiscard]] tl::expected<void, std::string> block_device_validity_checks(
     const fs::path& block_device) {
   // check if device exists
@@ -111,93 +288,541 @@ load_audio_files(const Audio_file_paths& audio_file_paths) {
 }
 
 
-}  // namespace
+[[nodiscard]] tl::expected<void, std::string> verify_written_audio(
+    const fs::path& out_path, const fs::path& in_audio_path,
+    const std::uint32_t checksum) {
+  const auto written_checksum = TRY(read_back_crc32c(out_path));
+  if (written_checksum != checksum) {
+    return tl::make_unexpected(
+        fmt::format("The contents of {} read back from the device don't match the "
+                    "converted {}. Checksum was {:08x}, expected {:08x}.",
+                    out_path, in_audio_path, written_checksum, checksum));
+  }
+  fmt::print("\t✔ verified {}\n", in_audio_path);
+  return {};
+}
 
-tl::expected<void, std::string> write_audio_to_device(const Parsed_arguments& args) {
-  fmt::print("Verifying block device {}... ", args.block_device);
-  REQ(block_device_validity_checks(args.block_device))
+// journals each written file. When verifying, a file is first read back while the
+// next is written, and only journaled once it matches.
+class Written_file_recorder {
+ private:
+  Write_journal& _journal;
+  const bool _verify;
+  std::future<tl::expected<void, std::string>> _pending_verification{};
+  Journal_entry _pending_entry{};
+
+ public:
+  Written_file_recorder(Write_journal& journal, const bool verify)
+      : _journal{journal}, _verify{verify} {}
+
+  [[nodiscard]] tl::expected<void, std::string> written(const Journal_entry& entry,
+                                                        const fs::path& out_path,
+                                                        const fs::path& in_audio_path) {
+    fmt::print("\t✔ wrote {}\n", in_audio_path);
+    if (!_verify) {
+      return _journal.record(entry);
+    }
+
+    REQ(finish())
+    _pending_entry = entry;
+    _pending_verification = std::async(std::launch::async, verify_written_audio,
+                                       out_path, in_audio_path, entry.checksum);
+    return {};
+  }
+
+  [[nodiscard]] tl::expected<void, std::string> finish() {
+    if (!_pending_verification.valid()) {
+      return {};
+    }
+    REQ(_pending_verification.get())
+    return _journal.record(_pending_entry);
+  }
+};
+
+// keeps converted words in memory until they're written
+class Memory_sink : public Conversion_sink {
+ public:
+  std::vector<Converted_audio> converted{};
+
+  tl::expected<std::span<std::byte>, std::string> allocate(
+      const fs::path&, const std::size_t size) override {
+    auto& words = converted.emplace_back().words;
+    words.resize(size);
+    return words;
+  }
 
-  const auto mounting = TRY(get_destination_mounting(args.block_device));
+  tl::expected<void, std::string> commit(const fs::path&,
+                                         const std::uint32_t checksum) override {
+    converted.back().checksum = checksum;
+    return {};
+  }
+};
+
+// an output's file for an audio file, relative to the mount point
+[[nodiscard]] fs::path output_file_path(const Output& output,
+                                        const fs::path& audio_file_path) {
+  return output.directory / output_file_name(audio_file_path);
+}
+
+// encodes converted words straight into the mapped pages of their destination files
+class Mapped_file_sink : public Conversion_sink {
+ private:
+  const fs::path& _mount_point;
+  const Output& _output;
+  const Write_layout& _layout;
+  Written_file_recorder& _recorder;
+  std::optional<Mapped_output_file> _file{};
+
+ public:
+  Mapped_file_sink(const fs::path& mount_point, const Output& output,
+                   const Write_layout& layout, Written_file_recorder& recorder)
+      : _mount_point{mount_point},
+        _output{output},
+        _layout{layout},
+        _recorder{recorder} {}
+
+  tl::expected<std::span<std::byte>, std::string> allocate(
+      const fs::path& audio_file, const std::size_t size) override {
+    _file = TRY(Mapped_output_file::create(
+        _mount_point / output_file_path(_output, audio_file), size, _layout));
+    return _file->data();
+  }
+
+  tl::expected<void, std::string> commit(const fs::path& audio_file,
+                                         const std::uint32_t checksum) override {
+    const Journal_entry entry{
+        .file_name = output_file_path(_output, audio_file).string(),
+        .size = _file->data().size(),
+        .checksum = checksum,
+        .fingerprint = conversion_fingerprint(_output.args, audio_file)};
+    REQ(_file->commit())
+    _file.reset();
+    return _recorder.written(entry, _mount_point / entry.file_name, audio_file);
+  }
+};
+
+// writes every converted audio as a clip of a single bundle, named by its input file
+[[nodiscard]] tl::expected<void, std::string> write_bundled_audio(
+    const Output& output, const fs::path& mount_point, const Write_layout& layout,
+    const Audio_file_paths& audio_file_paths,
+    const std::vector<Converted_audio>& converted_audios,
+    Written_file_recorder& recorder) {
+  const auto& args = output.args;
+  std::vector<Bundle_clip> clips;
+  std::vector<std::span<const std::byte>> clip_words;
+  for (std::size_t audio_idx = 0; audio_idx < converted_audios.size(); ++audio_idx) {
+    const auto& words = converted_audios[audio_idx].words;
+    clips.push_back({.name = audio_file_paths[audio_idx].stem().string(),
+                     .length = words.size(),
+                     .sample_rate = static_cast<std::uint32_t>(args.sample_rate),
+                     .word_size = static_cast<std::uint8_t>(
+                         args.bits > 0 ? 0 : args.word_size),
+                     .bits = static_cast<std::uint8_t>(args.bits),
+                     .byte_order = args.endian});
+    clip_words.push_back(words);
+  }
+
+  const auto size = layout_bundle(clips);
+  const auto file_name = output.directory / bundle_file_name;
+  const auto out_path = mount_point / file_name;
+  const auto checksum = TRY(write_bundle(out_path, clips, clip_words, layout));
+  const Journal_entry entry{.file_name = file_name.string(),
+                            .size = size,
+                            .checksum = checksum,
+                            .fingerprint = 0};
+  return recorder.written(entry, out_path, out_path);
+}
+
+// Every loaded audio is resampled once per distinct output rate, with the finest
+// converter any output at that rate needs. Each output then only remaps the shared
+// resampled signal and encodes it into its own sink.
+[[nodiscard]] tl::expected<void, std::string> convert_audio_files(
+    const std::vector<Output>& outputs,
+    const std::vector<std::pair<fs::path, Audio_signal_t>>& loaded_audios,
+    const std::span<Conversion_sink* const> sinks) {
+  // indices of the outputs at each sample rate, in the order the rates first appear
+  std::vector<std::pair<int, std::vector<std::size_t>>> rate_outputs;
+  for (std::size_t output_idx = 0; output_idx < outputs.size(); ++output_idx) {
+    const auto sample_rate = outputs[output_idx].args.sample_rate;
+    auto rate_it =
+        rgs::find(rate_outputs, sample_rate, [](const auto& r) { return r.first; });
+    if (rate_it == rate_outputs.end()) {
+      rate_it = rate_outputs.insert(rate_it, {sample_rate, {}});
+    }
+    rate_it->second.push_back(output_idx);
+  }
+
+  for (const auto& [in_audio_path, loaded_audio] : loaded_audios) {
+    for (const auto& [sample_rate, output_idxs] : rate_outputs) {
+      const Audio_signal_t* resampled = &loaded_audio;
+      std::optional<Audio_signal_t> resampled_audio;
+      std::string converter_note;
+      if (loaded_audio.sample_rate() != sample_rate) {
+        auto converter = resample_converter(outputs[output_idxs.front()].args);
+        for (const auto output_idx : output_idxs) {
+          converter =
+              finer_converter(converter, resample_converter(outputs[output_idx].args));
+        }
+        resampled_audio = TRY(loaded_audio.resampled(sample_rate, converter)
+                                  .map_error([](const auto& err) {
+                                    return fmt::format("Failed to resample: {}.",
+                                                       audio_error_message(err));
+                                  }));
+        resampled = &*resampled_audio;
+        converter_note = fmt::format(" with {}", src_get_name(converter));
+      }
+      fmt::print("\t✔ resampled {}{}", in_audio_path, converter_note);
+
+      for (const auto output_idx : output_idxs) {
+        const auto& output = outputs[output_idx];
+        REQ(encode_audio(output.args, in_audio_path, *resampled, *sinks[output_idx]))
+        const auto directory_note = output.directory.empty()
+                                        ? std::string{}
+                                        : fmt::format(" into {}", output.directory);
+        fmt::print("\r\t✔ resampled  ✔ remapped {}{}{}\n", in_audio_path,
+                   converter_note, directory_note);
+      }
+    }
+  }
+
+  return {};
+}
+
+[[nodiscard]] tl::expected<void, std::string> create_output_directories(
+    const fs::path& mount_point, const std::vector<Output>& outputs) {
+  for (const auto& output : outputs) {
+    std::error_code ec;
+    fs::create_directories(mount_point / output.directory, ec);
+    if (ec) {
+      return tl::make_unexpected(fmt::format("Failed to create the directory {}: {}",
+                                             mount_point / output.directory,
+                                             ec.message()));
+    }
+  }
+  return {};
+}
+
+// files are written in units sized by the device's queue geometry, unless overridden
+[[nodiscard]] Write_layout device_write_layout(const Parsed_arguments& args,
+                                              const fs::path& block_device) {
+  const auto geometry = read_device_geometry(block_device);
+  if (args.write_unit > 0) {
+    return {.unit_size = static_cast<std::size_t>(args.write_unit),
+            .partition_start = geometry.partition_start};
+  }
+
+  // whole multiples of the device's own I/O size
+  const auto unit_size =
+      geometry.optimal_io_size > 0 ? geometry.optimal_io_size : default_write_unit_size;
+  const auto io_size =
+      std::max({geometry.minimum_io_size, geometry.physical_block_size, std::size_t{1}});
+  return {.unit_size = (unit_size + io_size - 1) / io_size * io_size,
+          .partition_start = geometry.partition_start};
+}
+
+// checks that a block device is a partition miley reads, mounted with a FAT filesystem
+[[nodiscard]] tl::expected<Mounting, std::string> verified_destination(
+    const fs::path& block_device) {
+  REQ(block_device_validity_checks(block_device))
+
+  const auto mounting = TRY(get_destination_mounting(block_device));
 
   // check that filesystem of provided path is FAT
   if (mounting.fs_name != "vfat") {
     return tl::make_unexpected(
         fmt::format("The block device, {}, is incorrectly formatted with the {} "
                     "filesystem. It must be formatted in the FAT32 filesystem.",
-                    args.block_device, mounting.fs_name));
+                    block_device, mounting.fs_name));
   }
+  return mounting;
+}
+
+// the space available at the mount point, which must fit write_size bytes
+[[nodiscard]] tl::expected<std::uintmax_t, std::string> available_space_for(
+    const fs::path& mount_point, const std::uintmax_t write_size) {
+  // the device may be removed at any time while it's watched
+  std::error_code ec;
+  const auto available_space = fs::space(mount_point, ec).available;
+  if (ec) {
+    return tl::make_unexpected(fmt::format("Couldn't read the space available at {}: {}",
+                                           mount_point, ec.message()));
+  } else if (available_space < write_size) {
+    return tl::make_unexpected(fmt::format(
+        "The provided block device lacks the available space to store the specified "
+        "audio files. {:.1f} MiB are required, but only {:.1f} MiB are available.",
+        mebibytes(write_size), mebibytes(available_space)));
+  }
+  return available_space;
+}
+
+// converts every output's audio into memory, ahead of writing it
+[[nodiscard]] tl::expected<std::vector<Memory_sink>, std::string> convert_to_memory(
+    const std::vector<Output>& outputs,
+    const std::vector<std::pair<fs::path, Audio_signal_t>>& loaded_audios) {
+  std::vector<Memory_sink> memory_sinks(outputs.size());
+  std::vector<Conversion_sink*> sinks;
+  for (auto& memory_sink : memory_sinks) {
+    sinks.push_back(&memory_sink);
+  }
+  REQ(convert_audio_files(outputs, loaded_audios, sinks))
+  return memory_sinks;
+}
+
+// writes every output's audio, converted into memory, onto the mounted device
+[[nodiscard]] tl::expected<void, std::string> write_converted_audio(
+    const std::vector<Output>& outputs, const Audio_file_paths& audio_file_paths,
+    const std::vector<Memory_sink>& memory_sinks, const fs::path& mount_point,
+    const Write_layout& layout, Written_file_recorder& recorder) {
+  REQ(create_output_directories(mount_point, outputs))
+  for (std::size_t output_idx = 0; output_idx < outputs.size(); ++output_idx) {
+    const auto& output = outputs[output_idx];
+    const auto& converted_audios = memory_sinks[output_idx].converted;
+    if (output.args.bundle) {
+      REQ(write_bundled_audio(output, mount_point, layout, audio_file_paths,
+                              converted_audios, recorder))
+      continue;
+    }
+
+    for (std::size_t audio_idx = 0; audio_idx < converted_audios.size(); ++audio_idx) {
+      const auto& in_audio_path = audio_file_paths[audio_idx];
+      const auto& converted = converted_audios[audio_idx];
+      const Journal_entry entry{
+          .file_name = output_file_path(output, in_audio_path).string(),
+          .size = converted.words.size(),
+          .checksum = converted.checksum,
+          .fingerprint = conversion_fingerprint(output.args, in_audio_path)};
+      const auto out_path = mount_point / entry.file_name;
+
+      REQ(write_file_atomically(out_path, converted.words, layout))
+      REQ(recorder.written(entry, out_path, in_audio_path))
+    }
+  }
+  return {};
+}
+
+// audio converted once, to be written onto every watched device
+struct Converted_set {
+  std::vector<Output> outputs{};
+  Audio_file_paths audio_file_paths{};
+  std::vector<Memory_sink> memory_sinks{};
+  std::uintmax_t write_size{0};
+};
+
+// only a drive's first partition is written, as miley reads no other
+[[nodiscard]] bool is_first_partition(const fs::path& block_device) {
+  const auto drive_partitions = read_drive_partitions(block_device);
+  return !drive_partitions.empty() && drive_partitions.front() == block_device;
+}
+
+// Waits for an announced block device to be mounted, such as by udisks, before
+// checking it as a destination and writing the converted set onto it. Each device
+// keeps its own journal while it's written.
+[[nodiscard]] tl::expected<void, std::string> write_watched_device(
+    const Parsed_arguments& args, const fs::path& block_device,
+    const Converted_set& converted) {
+  const auto deadline = std::chrono::steady_clock::now() + watched_mount_timeout;
+  while (!get_destination_mounting(block_device) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(watched_mount_poll_interval);
+  }
+  const auto mounting = TRY(verified_destination(block_device));
+  REQ(available_space_for(mounting.mount_point, converted.write_size))
+  fmt::print("Writing onto {} at {}... \n", block_device, mounting.mount_point);
+
+  auto journal = Write_journal::read(mounting.mount_point, false);
+  REQ(journal.open_for_recording(false))
+  Written_file_recorder recorder(journal, args.verify);
+  REQ(write_converted_audio(converted.outputs, converted.audio_file_paths,
+                            converted.memory_sinks, mounting.mount_point,
+                            device_write_layout(args, block_device), recorder))
+  REQ(recorder.finish())
+  return journal.remove();
+}
+
+}  // namespace
+
+tl::expected<void, std::string> write_audio_to_device(const Parsed_arguments& args) {
+  fmt::print("Verifying block device {}... ", args.block_device);
+  const auto mounting = TRY(verified_destination(args.block_device));
+  fmt::print("✔\n");
+  const auto layout = device_write_layout(args, args.block_device);
+  fmt::print("\twriting in {} KiB units, aligned from a partition offset of {} bytes\n",
+             layout.unit_size >> 10, layout.partition_start);
+
+  // skip files that an interrupted run completed with the same parameters
+  auto journal = Write_journal::read(mounting.mount_point, args.resume);
+  Audio_file_paths remaining_files;
+  for (const auto& audio_file_path : args.audio_files) {
+    const auto fingerprint = conversion_fingerprint(args, audio_file_path);
+    const auto* const entry = journal.completed(
+        mounting.mount_point, output_file_name(audio_file_path), fingerprint);
+    if (entry == nullptr) {
+      remaining_files.push_back(audio_file_path);
+    } else {
+      if (args.verify) {
+        REQ(verify_written_audio(mounting.mount_point / entry->file_name,
+                                 audio_file_path, entry->checksum))
+      }
+      fmt::print("\t✔ already written {}\n", audio_file_path);
+    }
+  }
+  if (remaining_files.empty()) {
+    return journal.remove();
+  }
+
+  // check all audio files and the space they'll occupy before decoding any
+  fmt::print("Preflighting audio files... ");
+  const auto outputs = device_outputs(args);
+  const auto preflight = TRY(preflight_audio_files(args, remaining_files, outputs));
+  const auto available_space =
+      TRY(available_space_for(mounting.mount_point, preflight.write_size));
   fmt::print("✔\n");
+  fmt::print(
+      "\t{} file{}: decode {} frames, resample {} frames, write {:.1f} of {:.1f} MiB "
+      "available\n",
+      remaining_files.size(), remaining_files.size() == 1 ? "" : "s",
+      preflight.decode_frames, preflight.resample_frames,
+      mebibytes(preflight.write_size), mebibytes(available_space));
 
   // load all audio files before writing, to ensure they can all be
   // first opened loaded without decoding issues.
   fmt::print("Loading audio files... \n");
-  const auto loaded_audios = TRY(load_audio_files(args.audio_files));
-
-  // resample & remap audio
-  fmt::print("Converting audio signals... \n");
-  std::vector<std::vector<std::byte>> converted_audios;
-  switch (args.word_size) {
-    case 1:
-      converted_audios =
-          TRY((convert_audio<InSample, std::uint8_t>(args, loaded_audios)));
-      break;
-    case 2:
-      converted_audios =
-          TRY((convert_audio<InSample, std::uint16_t>(args, loaded_audios)));
-      break;
-    case 4:
-      converted_audios =
-          TRY((convert_audio<InSample, std::uint32_t>(args, loaded_audios)));
-      break;
-    case 8:
-      converted_audios =
-          TRY((convert_audio<InSample, std::uint64_t>(args, loaded_audios)));
-      break;
-    default:
-      return tl::make_unexpected(fmt::format(
-          "Cannot convert audio samples to a word size of {} bytes", args.word_size));
-  }
-
-  // ensure that specified device has sufficient available space
-  const auto write_size = std::accumulate(
-      converted_audios.cbegin(), converted_audios.cend(), 0u,
-      [](const auto& acc, const auto& curr) { return acc + curr.size(); });
-
-  if (const auto available_space = fs::space(mounting.mount_point).available;
-      available_space < write_size) {
-    return tl::make_unexpected(
-        "The provided block device lacks the available space to store the specified "
-        "audio files");
+  const auto loaded_audios =
+      TRY(load_audio_files(remaining_files, preflight.frame_ranges));
+
+  const auto accept_write = [&] {
+    const auto num_files = loaded_audios.size() * outputs.size();
+    return user_accept_dialog(
+        fmt::format("\nWould you like to proceed to write {} raw audio file{}onto {}?",
+                    num_files, num_files == 1 ? " " : "s ", mounting.mount_point));
+  };
+  // Nothing, not even the journal, is written to the device until the user accepts.
+  // So declining keeps what an interrupted run recorded, for a later resume.
+  Written_file_recorder recorder(journal, args.verify);
+
+  if (args.mmap) {
+    // prompt user before converting, as conversion writes to the device
+    if (!accept_write()) {
+      return {};
+    }
+    REQ(journal.open_for_recording(args.resume))
+    REQ(create_output_directories(mounting.mount_point, outputs))
+    fmt::print("Converting audio signals onto the device... \n");
+    std::vector<Mapped_file_sink> mapped_sinks;
+    mapped_sinks.reserve(outputs.size());
+    std::vector<Conversion_sink*> sinks;
+    for (const auto& output : outputs) {
+      sinks.push_back(
+          &mapped_sinks.emplace_back(mounting.mount_point, output, layout, recorder));
+    }
+    REQ(convert_audio_files(outputs, loaded_audios, sinks))
+  } else {
+    // resample & remap audio
+    fmt::print("Converting audio signals... \n");
+    const auto memory_sinks = TRY(convert_to_memory(outputs, loaded_audios));
+
+    // prompt user before writing
+    if (!accept_write()) {
+      return {};
+    }
+    REQ(journal.open_for_recording(args.resume))
+
+    // write converted audio to block device
+    REQ(write_converted_audio(outputs, remaining_files, memory_sinks,
+                              mounting.mount_point, layout, recorder))
+  }
+  REQ(recorder.finish())
+
+  // nothing is left to resume
+  return journal.remove();
+}
+
+tl::expected<void, std::string> watch_devices(const Parsed_arguments& args) {
+  auto events = TRY(open_device_event_source(*args.watch));
+
+  // every device is written from the same audio, converted before any arrives
+  fmt::print("Preflighting audio files... ");
+  Converted_set converted{.outputs = device_outputs(args),
+                          .audio_file_paths = args.audio_files};
+  const auto preflight =
+      TRY(preflight_audio_files(args, converted.audio_file_paths, converted.outputs));
+  converted.write_size = preflight.write_size;
+  fmt::print("✔\n");
+  fmt::print("\t{} file{}: decode {} frames, resample {} frames, write {:.1f} MiB per "
+             "device\n",
+             converted.audio_file_paths.size(),
+             converted.audio_file_paths.size() == 1 ? "" : "s", preflight.decode_frames,
+             preflight.resample_frames, mebibytes(preflight.write_size));
+  {
+    fmt::print("Loading audio files... \n");
+    const auto loaded_audios =
+        TRY(load_audio_files(converted.audio_file_paths, preflight.frame_ranges));
+    fmt::print("Converting audio signals... \n");
+    converted.memory_sinks = TRY(convert_to_memory(converted.outputs, loaded_audios));
   }
 
-  // prompt user before writing
-  if (!user_accept_dialog(
-          fmt::format("\nWould you like to proceed to write {} raw audio file{}onto {}?",
-                      converted_audios.size(), converted_audios.size() == 1 ? " " : "s ",
-                      mounting.mount_point))) {
+  // a single prompt covers every device that's announced
+  const auto num_files = converted.audio_file_paths.size() * converted.outputs.size();
+  if (!user_accept_dialog(fmt::format(
+          "\nWould you like to write {} raw audio file{}onto every FAT32 device that's "
+          "inserted?",
+          num_files, num_files == 1 ? " " : "s "))) {
     return {};
   }
 
-  // write converted audio to block device
-  for (std::size_t audio_idx = 0; audio_idx < converted_audios.size(); ++audio_idx) {
-    const auto& in_audio_path = loaded_audios[audio_idx].first;
-    const auto& converted = converted_audios[audio_idx];
-    const auto out_path =
-        mounting.mount_point / in_audio_path.filename().replace_extension("raw");
-    const auto open_mode =
-        std::ios_base::out | std::ios_base::binary | std::ios_base::trunc;
-
-    std::ofstream out_file(out_path.string(), open_mode);
-    if (!out_file.good()) {
-      return tl::make_unexpected(
-          fmt::format("Couldn't open the destination file: {}.", out_path));
+  // Each device is written on its own thread, so that several are written at once.
+  // A device announced again while it's being written isn't written twice.
+  fmt::print("Watching for block devices on {}... \n", *args.watch);
+  struct Device_writer {
+    std::atomic<bool> done{false};
+    std::jthread thread{};
+  };
+  std::mutex writing_mutex;
+  std::set<fs::path> writing_devices;
+  std::list<Device_writer> writers;
+  while (const auto event = TRY(events->next())) {
+    if (event->action != "add" || event->subsystem != "block" ||
+        event->devtype != "partition") {
+      continue;
+    }
+    const auto block_device = fs::path("/dev") / event->devname;
+    if (!is_first_partition(block_device)) {
+      continue;
     }
 
-    out_file.write(std::bit_cast<char*>(converted.data()),
-                   static_cast<std::streamsize>(converted.size()));
-    fmt::print("\t✔ wrote {}\n", in_audio_path);
+    {
+      const std::scoped_lock lock(writing_mutex);
+      if (!writing_devices.insert(block_device).second) {
+        continue;
+      }
+    }
+
+    // finished writers are joined first, so a long watch doesn't accumulate them
+    std::erase_if(writers,
+                  [](const Device_writer& writer) { return writer.done.load(); });
+
+    fmt::print("Found block device {}\n", block_device);
+    auto& writer = writers.emplace_back();
+    writer.thread = std::jthread([&, &done = writer.done, block_device] {
+      // a device removed while it's probed fails alone, without ending other writes
+      try {
+        if (const auto w = write_watched_device(args, block_device, converted); !w) {
+          fmt::print(stderr, "Failed to write {}: {}\n", block_device, w.error());
+        } else {
+          fmt::print("✔ wrote {}\n", block_device);
+        }
+      } catch (const std::exception& e) {
+        fmt::print(stderr, "Failed to write {}: {}\n", block_device, e.what());
+      }
+      {
+        const std::scoped_lock lock(writing_mutex);
+        writing_devices.erase(block_device);
+      }
+      done = true;
+    });
   }
 
+  // devices being written are finished before returning
   return {};
 }
 
@@ -8,4 +8,7 @@ namespace cyrus {
 
 tl::expected<void, std::string> write_audio_to_device(const Parsed_arguments&);
 
+// writes every block device announced by the args.watch event source, until it ends
+tl::expected<void, std::string> watch_devices(const Parsed_arguments&);
+
 }  // namespace cyrus
@@ -0,0 +1,90 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cyrus/sample_conversions.hpp>
+#include <expect.hpp>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace cyrus;
+using tests::expect;
+
+namespace {
+
+// bytes past the packed stream that must be left untouched
+constexpr std::size_t guard_size{8};
+constexpr auto guard_byte = std::byte{0xA5};
+
+// reference inverse of pack_samples, reading one bit at a time
+[[nodiscard]] std::vector<std::uint32_t> unpack_samples(
+    const std::span<const std::byte> packed, const int bits, const std::endian byte_order,
+    const std::size_t num_samples) {
+  const auto width = static_cast<std::size_t>(bits);
+  std::vector<std::uint32_t> samples(num_samples, 0);
+  for (std::size_t i = 0; i < num_samples; ++i) {
+    for (std::size_t b = 0; b < width; ++b) {
+      const auto pos = i * width + b;
+      const auto byte = std::to_integer<std::uint32_t>(packed[pos / 8]);
+      if (byte_order == std::endian::little) {
+        samples[i] |= ((byte >> (pos % 8)) & 1u) << b;
+      } else {
+        samples[i] |= ((byte >> (7 - pos % 8)) & 1u) << (width - 1 - b);
+      }
+    }
+  }
+  return samples;
+}
+
+// packs random words, with bits set above the packed width too, and checks that
+// unpacking them recovers each word's low bits without writing past the stream
+template <std::unsigned_integral U>
+void check_round_trip(const int bits, const std::endian byte_order,
+                      const std::size_t num_samples) {
+  std::mt19937_64 rng{num_samples * 64 + static_cast<std::size_t>(bits)};
+  std::vector<U> samples(num_samples);
+  std::ranges::generate(samples, [&] { return static_cast<U>(rng()); });
+
+  const auto size = encoded_size(num_samples, sizeof(U), bits);
+  std::vector<std::byte> packed(size + guard_size, guard_byte);
+  pack_samples<U>(samples, bits, byte_order, {packed.data(), size});
+
+  const auto case_name =
+      fmt::format("{} {} bit samples in {} byte words, {} endian", num_samples, bits,
+                  sizeof(U), byte_order == std::endian::little ? "little" : "big");
+  expect(std::all_of(packed.begin() + static_cast<std::ptrdiff_t>(size), packed.end(),
+                     [](const std::byte b) { return b == guard_byte; }),
+         fmt::format("{}: wrote past the packed stream", case_name));
+
+  const auto mask = (std::uint64_t{1} << bits) - 1;
+  const auto unpacked = unpack_samples(packed, bits, byte_order, num_samples);
+  for (std::size_t i = 0; i < num_samples; ++i) {
+    if (!expect(unpacked[i] == (samples[i] & mask),
+                fmt::format("{}: sample {} unpacked as {:#x}, not {:#x}", case_name, i,
+                            unpacked[i], samples[i] & mask))) {
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  for (const auto num_samples : {0u, 1u, 7u, 9u, 2049u}) {
+    for (const auto byte_order : {std::endian::little, std::endian::big}) {
+      for (int bits = 1; bits <= 32; ++bits) {
+        if (bits <= 8) {
+          check_round_trip<std::uint8_t>(bits, byte_order, num_samples);
+        }
+        if (bits <= 16) {
+          check_round_trip<std::uint16_t>(bits, byte_order, num_samples);
+        }
+        check_round_trip<std::uint32_t>(bits, byte_order, num_samples);
+      }
+    }
+  }
+  return tests::test_result();
+}
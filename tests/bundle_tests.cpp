@@ -0,0 +1,162 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cyrus/bundle.hpp>
+#include <cyrus/checksum.hpp>
+#include <expect.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace cyrus;
+using tests::expect;
+
+namespace {
+
+// offset of the byte_order field within an index entry
+constexpr std::size_t byte_order_field{bundle_name_size + 8 + 8 + 4 + 1 + 1};
+
+// clips of words ending part way through a sector, exactly on one, and spanning
+// several, under names that fit, just fit and overflow the name field
+std::vector<Bundle_clip> test_clips() {
+  return {{.name = "ordinary_girl",
+           .length = 1'000,
+           .sample_rate = 44'100,
+           .word_size = 2,
+           .byte_order = std::endian::little},
+          {.name = std::string(bundle_name_size - 1, 'n'),
+           .length = bundle_sector_size,
+           .sample_rate = 20'000,
+           .word_size = 4,
+           .byte_order = std::endian::big},
+          {.name = "who_said_this_name_runs_well_past_the_field.wav",
+           .length = 3 * bundle_sector_size + 7,
+           .sample_rate = 48'000,
+           .bits = 12,
+           .byte_order = std::endian::big}};
+}
+
+std::vector<std::byte> clip_words(const std::size_t clip_idx, const std::size_t size) {
+  std::vector<std::byte> words(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    words[i] = static_cast<std::byte>((i * 7 + clip_idx * 31 + 1) & 0xFF);
+  }
+  return words;
+}
+
+std::vector<std::byte> read_file(const fs::path& path) {
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  std::vector<char> bytes(std::istreambuf_iterator<char>{file}, {});
+  const auto* const data = std::bit_cast<const std::byte*>(bytes.data());
+  return {data, data + bytes.size()};
+}
+
+void check_index(const std::vector<Bundle_clip>& clips,
+                 const std::vector<Bundle_clip>& index) {
+  if (!expect(index.size() == clips.size(),
+              fmt::format("read {} clips from the index, not {}", index.size(),
+                          clips.size()))) {
+    return;
+  }
+  for (std::size_t i = 0; i < clips.size(); ++i) {
+    const auto& clip = clips[i];
+    const auto& entry = index[i];
+    const auto name = clip.name.substr(0, bundle_name_size - 1);
+    expect(entry.name == name,
+           fmt::format("clip {} is named {}, not {}", i, entry.name, name));
+    expect(entry.offset == clip.offset && entry.length == clip.length,
+           fmt::format("clip {} is indexed at {} for {} bytes, not {} for {}", i,
+                       entry.offset, entry.length, clip.offset, clip.length));
+    expect(entry.sample_rate == clip.sample_rate && entry.word_size == clip.word_size &&
+               entry.bits == clip.bits,
+           fmt::format("clip {} has a different sample rate or word format", i));
+    expect(entry.byte_order == clip.byte_order,
+           fmt::format("clip {} has a different byte order", i));
+  }
+}
+
+void check_bundle(const fs::path& bundle_path) {
+  auto clips = test_clips();
+  const auto bundle_size = layout_bundle(clips);
+
+  // the index fits in the first sector, and each clip starts on its own
+  auto expected_offset = bundle_sector_size;
+  for (const auto& clip : clips) {
+    expect(clip.offset == expected_offset,
+           fmt::format("{} laid out at {}, not {}", clip.name, clip.offset,
+                       expected_offset));
+    expected_offset +=
+        (clip.length + bundle_sector_size - 1) / bundle_sector_size * bundle_sector_size;
+  }
+  expect(bundle_size == expected_offset,
+         fmt::format("bundle laid out as {} bytes, not {}", bundle_size,
+                     expected_offset));
+
+  std::vector<std::vector<std::byte>> words;
+  std::vector<std::span<const std::byte>> word_spans;
+  for (std::size_t i = 0; i < clips.size(); ++i) {
+    words.push_back(clip_words(i, clips[i].length));
+    word_spans.emplace_back(words.back());
+  }
+  const auto checksum = write_bundle(bundle_path, clips, word_spans);
+  if (!expect(checksum.has_value(), "writing the bundle")) {
+    return;
+  }
+
+  const auto bytes = read_file(bundle_path);
+  expect(bytes.size() == bundle_size,
+         fmt::format("wrote {} bytes, not {}", bytes.size(), bundle_size));
+  expect(crc32c(bytes) == *checksum, "the returned checksum covers the whole bundle");
+
+  // the byte order is a single byte, 1 only for big-endian clips
+  for (std::size_t i = 0; i < clips.size(); ++i) {
+    const auto field_idx = bundle_header_size + i * bundle_entry_size + byte_order_field;
+    const auto expected_field = std::byte{clips[i].byte_order == std::endian::big};
+    expect(field_idx < bytes.size() && bytes[field_idx] == expected_field,
+           fmt::format("clip {} has a byte_order field other than {}", i,
+                       std::to_integer<int>(expected_field)));
+  }
+
+  // each clip's words lie at its offset, zero padded to the next sector
+  for (std::size_t i = 0; i < clips.size(); ++i) {
+    const auto start = static_cast<std::ptrdiff_t>(clips[i].offset);
+    const auto end = start + static_cast<std::ptrdiff_t>(clips[i].length);
+    const auto next = static_cast<std::ptrdiff_t>(
+        i + 1 < clips.size() ? clips[i + 1].offset : bytes.size());
+    expect(std::equal(bytes.begin() + start, bytes.begin() + end, words[i].begin(),
+                      words[i].end()),
+           fmt::format("clip {} has different words at its offset", i));
+    expect(std::all_of(bytes.begin() + end, bytes.begin() + next,
+                       [](const std::byte b) { return b == std::byte{0}; }),
+           fmt::format("clip {} isn't zero padded", i));
+  }
+
+  const auto index = read_bundle_index(bundle_path);
+  if (expect(index.has_value(), "reading the bundle's index")) {
+    check_index(clips, *index);
+  }
+}
+
+}  // namespace
+
+int main() {
+  const auto bundle_path = fs::temp_directory_path() / "cyrus_bundle_tests.bin";
+  check_bundle(bundle_path);
+
+  // anything else is refused
+  {
+    std::ofstream not_bundle(bundle_path, std::ios_base::out | std::ios_base::binary);
+    not_bundle << "RIFF, but not a bundle";
+  }
+  expect(!read_bundle_index(bundle_path).has_value(),
+         "reading a file that isn't a bundle fails");
+  fs::remove(bundle_path);
+  return tests::test_result();
+}
@@ -0,0 +1,101 @@
+#include <fmt/core.h>
+
+#include <cyrus/device_events.hpp>
+#include <expect.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace cyrus;
+using namespace std::string_view_literals;
+using tests::expect;
+
+namespace {
+
+// the kernel's uevent for a card's first partition, as received over netlink
+constexpr std::string_view netlink_uevent{
+    "add@/devices/pci0000:00/0000:00:14.0/usb2/2-1/2-1:1.0/host6/target6:0:0/"
+    "6:0:0:0/block/sdb/sdb1\0"
+    "ACTION=add\0"
+    "DEVPATH=/devices/pci0000:00/0000:00:14.0/usb2/2-1/2-1:1.0/host6/target6:0:0/"
+    "6:0:0:0/block/sdb/sdb1\0"
+    "SUBSYSTEM=block\0"
+    "MAJOR=8\0"
+    "MINOR=17\0"
+    "DEVNAME=sdb1\0"
+    "DEVTYPE=partition\0"
+    "DISKSEQ=12\0"
+    "PARTN=1\0"
+    "SEQNUM=5291\0"sv};
+
+// events recorded while a card was inserted and removed, one per line, as written
+// to stand in for the kernel's
+constexpr std::string_view recorded_events{
+    "ACTION=add SUBSYSTEM=usb DEVTYPE=usb_device DEVNAME=bus/usb/002/007\n"
+    "ACTION=add SUBSYSTEM=block DEVTYPE=disk DEVNAME=sdb\n"
+    "\n"
+    "ACTION=add DEVPATH=/devices/virtual/block/sdb/sdb1 SUBSYSTEM=block "
+    "DEVNAME=sdb1 DEVTYPE=partition PARTN=1 SEQNUM=5291\n"
+    "ACTION=change\tSUBSYSTEM=block\tDEVTYPE=disk\tDEVNAME=sdb\n"
+    "ACTION=remove SUBSYSTEM=block DEVTYPE=partition DEVNAME=sdb1"};
+
+bool operator==(const Device_event& a, const Device_event& b) {
+  return a.action == b.action && a.subsystem == b.subsystem && a.devtype == b.devtype &&
+         a.devname == b.devname;
+}
+
+std::string describe(const Device_event& event) {
+  return fmt::format("{{{}, {}, {}, {}}}", event.action, event.subsystem,
+                     event.devtype, event.devname);
+}
+
+void check_recorded_events(const fs::path& events_path) {
+  auto source = open_device_event_source(events_path.string());
+  if (!expect(source.has_value(), "opening the recorded events")) {
+    return;
+  }
+
+  const std::vector<Device_event> expected{
+      {"add", "usb", "usb_device", "bus/usb/002/007"},
+      {"add", "block", "disk", "sdb"},
+      {"add", "block", "partition", "sdb1"},
+      {"change", "block", "disk", "sdb"},
+      {"remove", "block", "partition", "sdb1"}};
+  for (const auto& expected_event : expected) {
+    const auto event = (*source)->next();
+    if (!expect(event.has_value() && event->has_value(),
+                fmt::format("reading the event {}", describe(expected_event)))) {
+      return;
+    }
+    expect(**event == expected_event,
+           fmt::format("read the event {}, not {}", describe(**event),
+                       describe(expected_event)));
+  }
+
+  const auto end = (*source)->next();
+  expect(end.has_value() && !end->has_value(), "no more events after the last line");
+}
+
+}  // namespace
+
+int main() {
+  const auto event = parse_uevent(netlink_uevent);
+  expect(event == Device_event{"add", "block", "partition", "sdb1"},
+         fmt::format("parsed the netlink uevent as {}", describe(event)));
+  expect(parse_uevent("") == Device_event{}, "an empty uevent has no fields");
+
+  const auto events_path = fs::temp_directory_path() / "cyrus_device_events_tests.txt";
+  {
+    std::ofstream events_file(events_path);
+    events_file << recorded_events;
+  }
+  check_recorded_events(events_path);
+  fs::remove(events_path);
+
+  expect(!open_device_event_source(events_path.string()).has_value(),
+         "opening missing recorded events fails");
+  return tests::test_result();
+}
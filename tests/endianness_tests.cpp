@@ -0,0 +1,98 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cyrus/cpu_kernels.hpp>
+#include <cyrus/sample_conversions.hpp>
+#include <expect.hpp>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+using namespace cyrus;
+using tests::expect;
+
+namespace {
+
+// every length up to several of the widest vectors, so that each vectorized loop
+// runs with every possible tail, from unaligned starts
+constexpr std::size_t max_words{3 * 64 + 1};
+constexpr std::size_t max_offset{3};
+
+template <Sample S>
+std::vector<S> random_words(const std::size_t count) {
+  std::mt19937_64 rng{count};
+  std::vector<S> words(count);
+  std::ranges::generate(words, [&] {
+    const auto bits = rng();
+    S word;
+    std::memcpy(&word, &bits, sizeof(S));
+    return word;
+  });
+  return words;
+}
+
+// flips words from offset onwards with flip, checking every word against the scalar
+// fallback and that no word outside the flipped span changes
+template <Sample S, typename Flip>
+void check_flip(const std::string_view name, Flip&& flip) {
+  for (std::size_t offset = 0; offset <= max_offset; ++offset) {
+    for (std::size_t count = 0; count <= max_words; ++count) {
+      const auto words = random_words<S>(offset + count + 1);
+      auto flipped = words;
+      flip(std::span<S>{flipped.data() + offset, count});
+
+      auto expected = words;
+      std::transform(words.begin() + static_cast<std::ptrdiff_t>(offset),
+                     words.begin() + static_cast<std::ptrdiff_t>(offset + count),
+                     expected.begin() + static_cast<std::ptrdiff_t>(offset),
+                     [](const S word) { return flip_sample_endianness(word); });
+      const auto size = sizeof(S) * words.size();
+      if (!expect(std::memcmp(flipped.data(), expected.data(), size) == 0,
+                  fmt::format("{} of {} {} byte words from offset {}", name, count,
+                              sizeof(S), offset))) {
+        return;
+      }
+    }
+  }
+}
+
+template <Sample S>
+void check_sample_flip() {
+  check_flip<S>("flip_endianness", [](const std::span<S> words) {
+    flip_endianness<S>(words);
+  });
+}
+
+template <std::unsigned_integral U>
+void check_kernel_flip(const Kernel_variant variant) {
+  check_flip<U>(fmt::format("{} kernels::flip_endianness", kernel_variant_name(variant)),
+                [](const std::span<U> words) { kernels::flip_endianness(words); });
+}
+
+}  // namespace
+
+int main() {
+  check_sample_flip<std::uint8_t>();
+  check_sample_flip<std::uint16_t>();
+  check_sample_flip<std::uint32_t>();
+  check_sample_flip<std::uint64_t>();
+  check_sample_flip<float>();
+  check_sample_flip<double>();
+
+  for (const auto variant :
+       {Kernel_variant::baseline, Kernel_variant::avx2, Kernel_variant::avx512}) {
+    if (!select_kernel_variant(variant)) {
+      fmt::print("skipping {} kernels, which this CPU doesn't support\n",
+                 kernel_variant_name(variant));
+      continue;
+    }
+    check_kernel_flip<std::uint16_t>(variant);
+    check_kernel_flip<std::uint32_t>(variant);
+    check_kernel_flip<std::uint64_t>(variant);
+  }
+  return tests::test_result();
+}
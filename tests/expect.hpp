@@ -0,0 +1,32 @@
+#pragma once
+
+#include <fmt/core.h>
+
+#include <cstdlib>
+#include <source_location>
+#include <string_view>
+
+namespace cyrus::tests {
+
+inline int failed_checks{0};
+
+// reports a failed check along with where it was made, without stopping the test
+inline bool expect(const bool passed, const std::string_view what,
+                   const std::source_location loc = std::source_location::current()) {
+  if (!passed) {
+    ++failed_checks;
+    fmt::print(stderr, "{}:{}: check failed: {}\n", loc.file_name(), loc.line(), what);
+  }
+  return passed;
+}
+
+// the test's exit status
+[[nodiscard]] inline int test_result() {
+  if (failed_checks > 0) {
+    fmt::print(stderr, "{} checks failed\n", failed_checks);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace cyrus::tests
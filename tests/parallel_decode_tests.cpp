@@ -0,0 +1,89 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cyrus/audio_signal.hpp>
+#include <expect.hpp>
+#include <filesystem>
+#include <numbers>
+#include <random>
+#include <sndfile.hh>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace cyrus;
+using tests::expect;
+
+namespace {
+
+// long enough to be decoded in several runs, ending part way through one
+constexpr sf_count_t test_frames{3 * detail::min_parallel_decode_frames + 12'345};
+constexpr int test_sample_rate{44'100};
+
+// writes a stereo FLAC file whose channels differ, so any misplaced run shows
+[[nodiscard]] bool write_test_flac(const fs::path& flac_path) {
+  std::mt19937 rng{2022};
+  std::uniform_real_distribution<float> noise{-0.05f, 0.05f};
+  std::vector<float> interleaved(static_cast<std::size_t>(2 * test_frames));
+  for (std::size_t frame = 0; frame < interleaved.size() / 2; ++frame) {
+    const auto t = static_cast<double>(frame) / test_sample_rate;
+    interleaved[2 * frame] =
+        static_cast<float>(0.5 * std::sin(2.0 * std::numbers::pi * 440.0 * t));
+    interleaved[2 * frame + 1] = noise(rng);
+  }
+
+  SndfileHandle flac(flac_path.c_str(), SFM_WRITE, SF_FORMAT_FLAC | SF_FORMAT_PCM_16, 2,
+                     test_sample_rate);
+  return flac.error() == 0 &&
+         flac.writef(interleaved.data(), test_frames) == test_frames;
+}
+
+// loads the range through a single handle and in parallel runs, which must match
+void check_parallel_load(const fs::path& flac_path, const Frame_range& range) {
+  Audio_signal<float> single;
+  const auto single_errc = single.load(flac_path, range);
+  Audio_signal<float> parallel;
+  const auto parallel_errc = parallel.load_parallel(
+      [&](std::size_t) { return SndfileHandle(flac_path.c_str()); }, range);
+
+  const auto case_name = fmt::format("frames from {} for {}", range.start,
+                                     range.frames ? fmt::format("{}", *range.frames)
+                                                  : std::string{"the rest"});
+  expect(single_errc == Audio_error_code::no_error &&
+             parallel_errc == Audio_error_code::no_error,
+         fmt::format("{}: loading failed", case_name));
+  expect(parallel.size() == single.size(),
+         fmt::format("{}: {} samples loaded in parallel, but {} through one handle",
+                     case_name, parallel.size(), single.size()));
+  expect(std::equal(parallel.begin(), parallel.end(), single.begin(), single.end()),
+         fmt::format("{}: samples loaded in parallel differ", case_name));
+}
+
+}  // namespace
+
+int main() {
+  // only formats that seek without decoding from the start are split
+  expect(detail::is_compressed_format(SF_FORMAT_FLAC | SF_FORMAT_PCM_16),
+         "FLAC is decoded in parallel");
+  expect(detail::is_compressed_format(SF_FORMAT_CAF | SF_FORMAT_ALAC_16),
+         "ALAC is decoded in parallel");
+  expect(!detail::is_compressed_format(SF_FORMAT_OGG | SF_FORMAT_VORBIS),
+         "Ogg Vorbis is decoded through one handle");
+  expect(!detail::is_compressed_format(SF_FORMAT_WAV | SF_FORMAT_PCM_16),
+         "WAV is read through one handle");
+
+  if (detail::available_threads() < 2) {
+    fmt::print("only one thread is available, so files are decoded in one run\n");
+  }
+
+  const auto flac_path = fs::temp_directory_path() / "cyrus_parallel_decode_tests.flac";
+  if (expect(write_test_flac(flac_path), "writing the test file")) {
+    check_parallel_load(flac_path, {});
+    check_parallel_load(flac_path,
+                        {.start = 1'000'003, .frames = 2'500'000, .context = 160});
+    check_parallel_load(flac_path, {.start = 77, .context = 640});
+  }
+  fs::remove(flac_path);
+  return tests::test_result();
+}
@@ -0,0 +1,114 @@
+#include <fmt/core.h>
+#include <samplerate.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cyrus/audio_signal.hpp>
+#include <expect.hpp>
+#include <filesystem>
+#include <numbers>
+#include <random>
+#include <sndfile.hh>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace cyrus;
+using tests::expect;
+
+namespace {
+
+// largest difference allowed between a segmented resampling and a single pass
+constexpr float segmented_tolerance{1e-5f};
+
+// long enough to be resampled in several segments given more than one thread
+constexpr std::size_t signal_size{4 * detail::min_parallel_resample_size};
+
+// tones spread up to near the Nyquist frequency, over a bed of white noise, so that
+// any filter taps cut off at a seam show up in the output
+std::vector<float> test_signal(const int sample_rate) {
+  std::mt19937 rng{2022};
+  std::uniform_real_distribution<float> noise{-0.1f, 0.1f};
+  std::vector<float> samples(signal_size);
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    const auto t = static_cast<double>(i) / sample_rate;
+    auto sample = 0.0;
+    for (const auto freq : {440.0, 5'000.0, 0.45 * sample_rate}) {
+      sample += 0.25 * std::sin(2.0 * std::numbers::pi * freq * t);
+    }
+    samples[i] = static_cast<float>(sample) + noise(rng);
+  }
+  return samples;
+}
+
+// resamples all of samples with one converter, as a reference
+std::vector<float> single_pass(const std::vector<float>& samples, const int from_rate,
+                               const int to_rate, const int converter) {
+  std::vector<float> out(resampled_size(samples.size(), from_rate, to_rate));
+  SRC_DATA conversion_data;
+  conversion_data.data_in = samples.data();
+  conversion_data.data_out = out.data();
+  conversion_data.input_frames = static_cast<long>(samples.size());
+  conversion_data.output_frames = static_cast<long>(out.size());
+  conversion_data.src_ratio = static_cast<double>(to_rate) / from_rate;
+  expect(src_simple(&conversion_data, converter, 1) == 0, "single pass resampling");
+  out.resize(static_cast<std::size_t>(conversion_data.output_frames_gen));
+  return out;
+}
+
+void check_segmented_resampling(const int from_rate, const int to_rate,
+                                const int converter) {
+  const auto wav_path = fs::temp_directory_path() / "cyrus_resample_tests.wav";
+  const auto samples = test_signal(from_rate);
+  {
+    SndfileHandle wav(wav_path.c_str(), SFM_WRITE, SF_FORMAT_WAV | SF_FORMAT_FLOAT, 1,
+                      from_rate);
+    wav.write(samples.data(), static_cast<sf_count_t>(samples.size()));
+  }
+
+  Audio_signal<float> signal;
+  const auto load_errc = signal.load(wav_path);
+  fs::remove(wav_path);
+  if (!expect(load_errc == Audio_error_code::no_error, "loading the test signal")) {
+    return;
+  }
+
+  const auto reference = single_pass(samples, from_rate, to_rate, converter);
+  const auto segmented = signal.resampled(to_rate, converter);
+  if (!expect(segmented.has_value(), "segmented resampling")) {
+    return;
+  }
+
+  const auto case_name = fmt::format("{} -> {} Hz with {}", from_rate, to_rate,
+                                     src_get_name(converter));
+  expect(segmented->size() == reference.size(),
+         fmt::format("{}: {} samples, where a single pass gives {}", case_name,
+                     segmented->size(), reference.size()));
+  float max_diff{0.0f};
+  for (std::size_t i = 0; i < std::min(segmented->size(), reference.size()); ++i) {
+    max_diff = std::max(max_diff, std::abs((*segmented)[i] - reference[i]));
+  }
+  expect(max_diff <= segmented_tolerance,
+         fmt::format("{}: differs from a single pass by up to {}", case_name, max_diff));
+}
+
+}  // namespace
+
+int main() {
+  if (detail::available_threads() < 2) {
+    fmt::print("only one thread is available, so signals are resampled in one pass\n");
+  }
+
+  // rates whose samples coincide every few samples, so that segment context isn't
+  // rounded up to a period long enough to cover any filter. Downsampling widens it.
+  constexpr std::pair<int, int> rates[]{
+      {22'050, 44'100}, {44'100, 48'000}, {48'000, 16'000}};
+  for (const auto converter :
+       {SRC_SINC_FASTEST, SRC_SINC_MEDIUM_QUALITY, SRC_SINC_BEST_QUALITY}) {
+    for (const auto& [from_rate, to_rate] : rates) {
+      check_segmented_resampling(from_rate, to_rate, converter);
+    }
+  }
+  return tests::test_result();
+}
@@ -0,0 +1,111 @@
+#include <fmt/core.h>
+#include <fmt/ostream.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cyrus/stream_source.hpp>
+#include <expect.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sndfile.hh>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace cyrus;
+using tests::expect;
+
+namespace {
+
+// frames read through the stream at a time, as when streaming to stdout
+constexpr sf_count_t block_frames{4096};
+
+// every sample of an audio file, as interleaved floats
+std::vector<float> read_samples(SndfileHandle sndfile_handle) {
+  std::vector<float> samples;
+  std::vector<float> block(static_cast<std::size_t>(block_frames * 2));
+  sf_count_t num_frames{0};
+  do {
+    num_frames = sndfile_handle.readf(block.data(), block_frames);
+    samples.insert(samples.end(), block.begin(),
+                   block.begin() + num_frames * sndfile_handle.channels());
+  } while (num_frames == block_frames);
+  return samples;
+}
+
+// pipes the audio file through a Stream_source, checking that it decodes the same
+// header and samples as the file opened by path
+void check_piped(const fs::path& audio_path) {
+  std::ifstream audio_file(audio_path, std::ios::binary);
+  const std::vector<char> bytes(std::istreambuf_iterator<char>{audio_file}, {});
+
+  int fds[2];
+  if (!expect(::pipe(fds) == 0, "creating a pipe")) {
+    return;
+  }
+  std::jthread writer([&bytes, write_fd = fds[1]] {
+    for (std::size_t written = 0; written < bytes.size();) {
+      const auto num_written = ::write(write_fd, bytes.data() + written,
+                                       bytes.size() - written);
+      if (num_written <= 0) {
+        break;
+      }
+      written += static_cast<std::size_t>(num_written);
+    }
+    ::close(write_fd);
+  });
+
+  Stream_source source(fds[0]);
+  SndfileHandle piped(Stream_source::virtual_io(), &source);
+  SndfileHandle by_path(audio_path.c_str());
+  expect(piped.error() == 0 && piped.frames() == by_path.frames() &&
+             piped.channels() == by_path.channels(),
+         fmt::format("{}: piped header declares {} frames, not {}", audio_path,
+                     piped.frames(), by_path.frames()));
+
+  const auto piped_samples = read_samples(piped);
+  const auto samples = read_samples(by_path);
+  expect(piped_samples.size() == samples.size(),
+         fmt::format("{}: {} samples piped, but {} read by path", audio_path,
+                     piped_samples.size(), samples.size()));
+  expect(piped_samples == samples,
+         fmt::format("{}: piped samples differ from those read by path", audio_path));
+
+  // the rest of the stream is drained, so the writer can finish
+  char drained[4096];
+  while (::read(fds[0], drained, sizeof(drained)) > 0) {
+  }
+  writer.join();
+  ::close(fds[0]);
+}
+
+}  // namespace
+
+int main() {
+  std::vector<fs::path> audio_paths;
+  for (const auto& entry : fs::directory_iterator(CYRUS_TEST_DATA_DIR)) {
+    if (entry.path().extension() == ".wav" || entry.path().extension() == ".aif") {
+      audio_paths.push_back(entry.path());
+    }
+  }
+  expect(!audio_paths.empty(), "finding audio files to pipe");
+
+  // a compressed stream too, which libsndfile decodes without seeking far
+  const auto flac_path = fs::temp_directory_path() / "cyrus_stream_source_tests.flac";
+  if (!audio_paths.empty()) {
+    SndfileHandle wav(audio_paths.front().c_str());
+    const auto samples = read_samples(wav);
+    SndfileHandle flac(flac_path.c_str(), SFM_WRITE, SF_FORMAT_FLAC | SF_FORMAT_PCM_16,
+                       wav.channels(), wav.samplerate());
+    flac.write(samples.data(), static_cast<sf_count_t>(samples.size()));
+  }
+
+  for (const auto& audio_path : audio_paths) {
+    check_piped(audio_path);
+  }
+  check_piped(flac_path);
+  fs::remove(flac_path);
+  return tests::test_result();
+}